@@ -0,0 +1,100 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <glib.h>
+
+#include "alloc.h"
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static __thread gboolean counting;
+static __thread guint64 allocations;
+static __thread guint64 allocated;
+
+static void *count(void *ptr)
+{
+	if(counting && ptr) {
+		allocations++;
+		allocated += malloc_usable_size(ptr);
+	}
+	return ptr;
+}
+
+void *malloc(size_t size)
+{
+	return count(__libc_malloc(size));
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	return count(__libc_calloc(nmemb, size));
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	return count(__libc_realloc(ptr, size));
+}
+
+gboolean alloc_count_supported(void)
+{
+	return TRUE;
+}
+
+void alloc_count_begin(void)
+{
+	allocations = 0;
+	allocated = 0;
+	counting = TRUE;
+}
+
+void alloc_count_end(guint64 *count, guint64 *bytes)
+{
+	counting = FALSE;
+	if(count)
+		*count = allocations;
+	if(bytes)
+		*bytes = allocated;
+}
+#else
+gboolean alloc_count_supported(void)
+{
+	return FALSE;
+}
+
+void alloc_count_begin(void)
+{
+}
+
+void alloc_count_end(guint64 *count, guint64 *bytes)
+{
+	if(count)
+		*count = 0;
+	if(bytes)
+		*bytes = 0;
+}
+#endif
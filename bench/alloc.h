@@ -0,0 +1,35 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_BENCH_ALLOC_H
+#define _CONNMAN_GTK_BENCH_ALLOC_H
+
+#include <glib.h>
+
+/*
+ * Counts the mallocs of the calling thread between begin and end. Only
+ * glibc lets the benchmark replace malloc, elsewhere nothing is counted.
+ * Older GLib needs G_SLICE=always-malloc for its slices to be seen.
+ */
+gboolean alloc_count_supported(void);
+void alloc_count_begin(void);
+void alloc_count_end(guint64 *count, guint64 *bytes);
+
+#endif /* _CONNMAN_GTK_BENCH_ALLOC_H */
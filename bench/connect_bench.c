@@ -0,0 +1,447 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Connects and disconnects one service or VPN over and over, and times
+ * each State it passes through from the Connect call on:
+ *
+ *	connect-bench --service=PATH [--count=N] [--address=ADDRESS]
+ *	connect-bench --vpn=PATH [--count=N]
+ *	connect-bench --mock [--mock-step=MS] [--mock-fail=N]
+ *
+ * Without --address the system bus is used. The service has to connect
+ * without an agent, so pick one whose passphrase is saved. With --mock
+ * the mock ConnMan is started on a private bus instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "interfaces.h"
+#include "mock.h"
+
+enum bench_state {
+	BENCH_ASSOCIATION,
+	BENCH_CONFIGURATION,
+	BENCH_READY,
+	BENCH_ONLINE,
+	BENCH_STATE_COUNT
+};
+
+static const gchar *state_names[BENCH_STATE_COUNT] = {
+	[BENCH_ASSOCIATION] = "association",
+	[BENCH_CONFIGURATION] = "configuration",
+	[BENCH_READY] = "ready",
+	[BENCH_ONLINE] = "online",
+};
+
+static GMainLoop *loop;
+static GDBusConnection *connection;
+static const gchar *bus_name, *interface;
+static gchar *state;
+
+/* milliseconds from Connect to each state, one entry per attempt seen */
+static GArray *times[BENCH_STATE_COUNT];
+static gint64 attempt_start;
+static gboolean attempt_seen[BENCH_STATE_COUNT];
+static gboolean connecting;
+static guint attempt, timeout_id;
+static guint connect_errors, failures, timeouts, not_online;
+
+static gchar *service;
+static gchar *vpn;
+static gchar *bus_address;
+static gint count = 20;
+static gint timeout = 30;
+static gboolean ready_only;
+static gboolean verbose;
+static gboolean use_mock;
+static gint mock_step = 20;
+static gint mock_fail;
+
+static void next_attempt(void);
+
+static gdouble since_start(void)
+{
+	return (gdouble)(g_get_monotonic_time() - attempt_start) / 1000;
+}
+
+static gboolean is_disconnected(const gchar *value)
+{
+	return !strcmp(value, "idle") || !strcmp(value, "failure") ||
+	       !strcmp(value, "disconnect");
+}
+
+static void end_attempt(const gchar *result)
+{
+	connecting = FALSE;
+	if(timeout_id) {
+		g_source_remove(timeout_id);
+		timeout_id = 0;
+	}
+	if(verbose)
+		printf("attempt %u: %s after %.1f ms\n", attempt, result,
+		       since_start());
+	next_attempt();
+}
+
+static void state_changed(const gchar *value)
+{
+	enum bench_state i;
+	gdouble ms;
+
+	g_free(state);
+	state = g_strdup(value);
+	if(!connecting)
+		return;
+
+	if(!strcmp(value, "failure")) {
+		failures++;
+		end_attempt("failure");
+		return;
+	}
+
+	for(i = 0; i < BENCH_STATE_COUNT; i++) {
+		if(strcmp(value, state_names[i]) || attempt_seen[i])
+			continue;
+		attempt_seen[i] = TRUE;
+		ms = since_start();
+		g_array_append_val(times[i], ms);
+		if(verbose)
+			printf("attempt %u: %s at %.1f ms\n", attempt, value,
+			       ms);
+	}
+
+	/* VPNs stop at ready, so do services without a way out */
+	if(attempt_seen[BENCH_ONLINE] ||
+	   (attempt_seen[BENCH_READY] && (vpn || ready_only)))
+		end_attempt("connected");
+}
+
+static void property_changed(GDBusConnection *connection,
+			     const gchar *sender, const gchar *path,
+			     const gchar *interface, const gchar *signal,
+			     GVariant *parameters, gpointer user_data)
+{
+	const gchar *name;
+	GVariant *value;
+
+	g_variant_get(parameters, "(&sv)", &name, &value);
+	if(!strcmp(name, "State"))
+		state_changed(g_variant_get_string(value, NULL));
+	g_variant_unref(value);
+}
+
+static gboolean attempt_timeout(gpointer user_data)
+{
+	timeout_id = 0;
+	if(attempt_seen[BENCH_READY]) {
+		not_online++;
+		end_attempt("ready, never online");
+	} else {
+		timeouts++;
+		end_attempt("timeout");
+	}
+	return G_SOURCE_REMOVE;
+}
+
+static void connect_cb(GObject *source, GAsyncResult *res,
+		       gpointer user_data)
+{
+	GError *error = NULL;
+	GVariant *ret;
+
+	ret = g_dbus_connection_call_finish(connection, res, &error);
+	if(ret) {
+		g_variant_unref(ret);
+		return;
+	}
+	if(connecting && GPOINTER_TO_UINT(user_data) == attempt) {
+		connect_errors++;
+		if(verbose)
+			printf("attempt %u: %s\n", attempt, error->message);
+		end_attempt("Connect failed");
+	}
+	g_error_free(error);
+}
+
+static const gchar *object_path(void)
+{
+	return vpn ? vpn : service;
+}
+
+static void start_connect(void)
+{
+	memset(attempt_seen, 0, sizeof(attempt_seen));
+	connecting = TRUE;
+	attempt++;
+	attempt_start = g_get_monotonic_time();
+	timeout_id = g_timeout_add_seconds((guint)timeout, attempt_timeout,
+					   NULL);
+	g_dbus_connection_call(connection, bus_name, object_path(),
+			       interface, "Connect", NULL, NULL,
+			       G_DBUS_CALL_FLAGS_NONE, timeout * 1000, NULL,
+			       connect_cb, GUINT_TO_POINTER(attempt));
+}
+
+static gboolean wait_disconnected(gpointer user_data)
+{
+	gint64 *deadline = user_data;
+
+	if(!is_disconnected(state) && g_get_monotonic_time() < *deadline)
+		return G_SOURCE_CONTINUE;
+	start_connect();
+	return G_SOURCE_REMOVE;
+}
+
+/* Disconnect first, so every attempt starts from the same state */
+static void next_attempt(void)
+{
+	gint64 *deadline;
+
+	g_dbus_connection_call(connection, bus_name, object_path(), interface,
+			       "Disconnect", NULL, NULL,
+			       G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL, NULL);
+	if(attempt == (guint)count) {
+		g_main_loop_quit(loop);
+		return;
+	}
+
+	deadline = g_malloc(sizeof(*deadline));
+	*deadline = g_get_monotonic_time() + timeout * G_USEC_PER_SEC;
+	g_timeout_add_full(G_PRIORITY_DEFAULT, 10, wait_disconnected,
+			   deadline, g_free);
+}
+
+static gint compare_double(gconstpointer a, gconstpointer b)
+{
+	gdouble x = *(const gdouble *)a, y = *(const gdouble *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Nearest rank */
+static gdouble percentile(GArray *values, guint p)
+{
+	guint rank = (values->len * p + 99) / 100;
+
+	return g_array_index(values, gdouble, rank ? rank - 1 : 0);
+}
+
+static void report(void)
+{
+	enum bench_state i;
+
+	printf("%u attempts on %s\n", attempt, object_path());
+	for(i = 0; i < BENCH_STATE_COUNT; i++) {
+		GArray *values = times[i];
+
+		if(!values->len)
+			continue;
+		g_array_sort(values, compare_double);
+		printf("%-14s n=%-4u p50 %8.1f ms  p95 %8.1f ms  "
+		       "p99 %8.1f ms\n", state_names[i], values->len,
+		       percentile(values, 50), percentile(values, 95),
+		       percentile(values, 99));
+	}
+	printf("failures: %u Connect errors, %u failure states, %u timeouts",
+	       connect_errors, failures, timeouts);
+	if(!vpn && !ready_only)
+		printf(", %u ready but never online", not_online);
+	printf("\n");
+}
+
+/* The object's State as its manager reports it */
+static gchar *initial_state(void)
+{
+	const gchar *manager, *method, *path, *value;
+	GVariant *ret, *objects, *properties;
+	GError *error = NULL;
+	GVariantIter iter;
+	gchar *found = NULL;
+
+	manager = vpn ? VPN_MANAGER_NAME : MANAGER_NAME;
+	method = vpn ? "GetConnections" : "GetServices";
+	ret = g_dbus_connection_call_sync(connection, bus_name, "/", manager,
+					  method, NULL,
+					  G_VARIANT_TYPE("(a(oa{sv}))"),
+					  G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+					  &error);
+	if(!ret) {
+		fprintf(stderr, "%s failed: %s\n", method, error->message);
+		g_error_free(error);
+		return NULL;
+	}
+
+	objects = g_variant_get_child_value(ret, 0);
+	g_variant_iter_init(&iter, objects);
+	while(!found && g_variant_iter_loop(&iter, "(&o@a{sv})", &path,
+					    &properties)) {
+		if(strcmp(path, object_path()))
+			continue;
+		if(!g_variant_lookup(properties, "State", "&s", &value))
+			value = "idle";
+		found = g_strdup(value);
+	}
+	g_variant_unref(objects);
+	g_variant_unref(ret);
+	if(!found)
+		fprintf(stderr, "%s is not known to %s\n", object_path(),
+			bus_name);
+	return found;
+}
+
+static GDBusConnection *bench_connect(void)
+{
+	GError *error = NULL;
+	GDBusConnection *conn;
+
+	if(bus_address)
+		conn = g_dbus_connection_new_for_address_sync(bus_address,
+				G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+				G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+				NULL, NULL, &error);
+	else
+		conn = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
+	if(!conn) {
+		fprintf(stderr, "Failed to connect to the bus: %s\n",
+			error->message);
+		g_error_free(error);
+	}
+	return conn;
+}
+
+static const GOptionEntry options[] = {
+	{ "service", 0, 0, G_OPTION_ARG_STRING, &service,
+		"Object path of the ConnMan service", "PATH" },
+	{ "vpn", 0, 0, G_OPTION_ARG_STRING, &vpn,
+		"Object path of the VPN connection", "PATH" },
+	{ "count", 0, 0, G_OPTION_ARG_INT, &count,
+		"Number of connects, 20 by default", "N" },
+	{ "timeout", 0, 0, G_OPTION_ARG_INT, &timeout,
+		"Seconds a connect may take, 30 by default", "S" },
+	{ "ready-only", 0, 0, G_OPTION_ARG_NONE, &ready_only,
+		"Do not wait for online", NULL },
+	{ "address", 0, 0, G_OPTION_ARG_STRING, &bus_address,
+		"Use the bus at ADDRESS instead of the system bus", "ADDRESS" },
+	{ "mock", 0, 0, G_OPTION_ARG_NONE, &use_mock,
+		"Connect against the mock ConnMan on a private bus", NULL },
+	{ "mock-step", 0, 0, G_OPTION_ARG_INT, &mock_step,
+		"Milliseconds the mock takes per state, 20 by default", "MS" },
+	{ "mock-fail", 0, 0, G_OPTION_ARG_INT, &mock_fail,
+		"Have the mock fail every Nth connect", "N" },
+	{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+		"Print every state of every attempt", NULL },
+	{ NULL }
+};
+
+int main(int argc, char *argv[])
+{
+	GOptionContext *context;
+	struct mock *mock = NULL;
+	GTestDBus *bus = NULL;
+	GError *error = NULL;
+	enum bench_state i;
+	int status = 1;
+	guint id;
+
+	context = g_option_context_new(NULL);
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		return 1;
+	}
+	g_option_context_free(context);
+	if(use_mock && !service && !vpn)
+		service = g_strdup("/net/connman/service/wifi_mock_0");
+	if(!service == !vpn || count < 1 || timeout < 1 || mock_step < 0 ||
+	   mock_fail < 0) {
+		fprintf(stderr, "Usage: %s --service=PATH | --vpn=PATH | "
+			"--mock [--count=N]\n", argv[0]);
+		return 1;
+	}
+
+	if(use_mock) {
+		gchar *daemon = g_find_program_in_path("dbus-daemon");
+
+		if(!daemon) {
+			fprintf(stderr, "No dbus-daemon, skipping\n");
+			return 77;
+		}
+		g_free(daemon);
+		bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+		g_test_dbus_up(bus);
+		g_free(bus_address);
+		bus_address = g_strdup(g_test_dbus_get_bus_address(bus));
+		mock = mock_new(bus_address);
+		mock_add_technology(mock, "wifi", TRUE);
+		mock_add_services(mock, "wifi", 1);
+		mock_add_vpn_connections(mock, 1);
+		mock_set_connect_timing(mock, (guint)mock_step,
+					(guint)mock_fail);
+		if(!mock_start(mock))
+			goto out;
+	}
+
+	connection = bench_connect();
+	if(!connection)
+		goto out;
+	bus_name = vpn ? CONNMAN_VPN_PATH : CONNMAN_PATH;
+	interface = vpn ? VPN_CONNECTION_NAME : SERVICE_NAME;
+	state = initial_state();
+	if(!state)
+		goto out;
+
+	for(i = 0; i < BENCH_STATE_COUNT; i++)
+		times[i] = g_array_new(FALSE, FALSE, sizeof(gdouble));
+	id = g_dbus_connection_signal_subscribe(connection, bus_name,
+						interface, "PropertyChanged",
+						object_path(), NULL,
+						G_DBUS_SIGNAL_FLAGS_NONE,
+						property_changed, NULL, NULL);
+
+	loop = g_main_loop_new(NULL, FALSE);
+	next_attempt();
+	g_main_loop_run(loop);
+	g_main_loop_unref(loop);
+	report();
+
+	g_dbus_connection_signal_unsubscribe(connection, id);
+	for(i = 0; i < BENCH_STATE_COUNT; i++)
+		g_array_free(times[i], TRUE);
+	status = 0;
+
+out:
+	if(connection) {
+		g_dbus_connection_flush_sync(connection, NULL, NULL);
+		g_object_unref(connection);
+	}
+	mock_free(mock);
+	if(bus) {
+		g_test_dbus_down(bus);
+		g_object_unref(bus);
+	}
+	g_free(state);
+	return status;
+}
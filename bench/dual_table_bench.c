@@ -0,0 +1,234 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compares the flat DualHashTable of util.c, keyed on interned names,
+ * with the nested tables of string copies it replaced, on the
+ * properties of a typical ConnMan service:
+ *
+ *	dual-table-bench [--services=N] [--iterations=N]
+ *
+ * Memory is what malloc handed out for the tables of one service, the
+ * values are left out as both designs store the same pointers.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "alloc.h"
+#include "util.h"
+
+static gint services = 1000;
+static gint iterations = 100;
+
+/* The properties and subkeys ConnMan reports for a wireless service */
+static const gchar *const keys[][2] = {
+	{ "Type", NULL }, { "Security", NULL }, { "State", NULL },
+	{ "Error", NULL }, { "Strength", NULL }, { "Favorite", NULL },
+	{ "Immutable", NULL }, { "AutoConnect", NULL }, { "Name", NULL },
+	{ "Nameservers", NULL }, { "Nameservers.Configuration", NULL },
+	{ "Timeservers", NULL }, { "Timeservers.Configuration", NULL },
+	{ "Domains", NULL }, { "Domains.Configuration", NULL },
+	{ "mDNS", NULL }, { "mDNS.Configuration", NULL },
+	{ "Ethernet", "Method" }, { "Ethernet", "Interface" },
+	{ "Ethernet", "Address" }, { "Ethernet", "MTU" },
+	{ "IPv4", "Method" }, { "IPv4", "Address" },
+	{ "IPv4", "Netmask" }, { "IPv4", "Gateway" },
+	{ "IPv4.Configuration", "Method" },
+	{ "IPv6", "Method" }, { "IPv6", "Address" },
+	{ "IPv6", "PrefixLength" }, { "IPv6", "Gateway" },
+	{ "IPv6", "Privacy" }, { "IPv6.Configuration", "Method" },
+	{ "IPv6.Configuration", "Privacy" },
+	{ "Proxy", "Method" }, { "Proxy.Configuration", "Method" },
+};
+
+/* The nested design: a table per property of subkeys, both copied */
+static gpointer nested_create(void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+				     (GDestroyNotify)g_hash_table_unref);
+}
+
+static void nested_set(gpointer table, const gchar *key,
+		       const gchar *subkey, gpointer value)
+{
+	GHashTable *t = g_hash_table_lookup(table, key);
+
+	if(!t) {
+		t = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					  NULL);
+		g_hash_table_insert(table, g_strdup(key), t);
+	}
+	g_hash_table_insert(t, g_strdup(subkey ? subkey : ""), value);
+}
+
+static gpointer nested_get(gpointer table, const gchar *key,
+			   const gchar *subkey)
+{
+	GHashTable *t = g_hash_table_lookup(table, key);
+
+	if(!t)
+		return NULL;
+	return g_hash_table_lookup(t, subkey ? subkey : "");
+}
+
+struct design {
+	const gchar *name;
+	gpointer (*create)(void);
+	void (*set)(gpointer table, const gchar *key, const gchar *subkey,
+		    gpointer value);
+	gpointer (*get)(gpointer table, const gchar *key,
+			const gchar *subkey);
+	void (*destroy)(gpointer table);
+};
+
+static gpointer flat_create(void)
+{
+	return dual_hash_table_new(NULL);
+}
+
+static void flat_set(gpointer table, const gchar *key, const gchar *subkey,
+		     gpointer value)
+{
+	hash_table_set_dual_key(table, key, subkey, value);
+}
+
+static gpointer flat_get(gpointer table, const gchar *key,
+			 const gchar *subkey)
+{
+	return hash_table_get_dual_key(table, key, subkey);
+}
+
+static const struct design designs[] = {
+	{ "nested", nested_create, nested_set, nested_get,
+	  (GDestroyNotify)g_hash_table_unref },
+	{ "flat", flat_create, flat_set, flat_get,
+	  (GDestroyNotify)dual_hash_table_unref },
+};
+
+static gdouble elapsed_ns(gint64 start, gdouble operations)
+{
+	return (gdouble)(g_get_monotonic_time() - start) * 1000 / operations;
+}
+
+static void fill(const struct design *design, gpointer table)
+{
+	guint i;
+
+	for(i = 0; i < G_N_ELEMENTS(keys); i++)
+		design->set(table, keys[i][0], keys[i][1], (gpointer)keys[i]);
+}
+
+static gboolean run(const struct design *design)
+{
+	gpointer *tables = g_new(gpointer, services);
+	guint64 allocations, bytes, update_allocations;
+	gdouble insert_ns, update_ns, lookup_ns;
+	gint64 start;
+	gint i, j;
+	guint k;
+
+	alloc_count_begin();
+	start = g_get_monotonic_time();
+	for(i = 0; i < services; i++) {
+		tables[i] = design->create();
+		fill(design, tables[i]);
+	}
+	insert_ns = elapsed_ns(start, (gdouble)services * G_N_ELEMENTS(keys));
+	alloc_count_end(&allocations, &bytes);
+
+	/* every property arrives again, as in a ServicesChanged */
+	alloc_count_begin();
+	start = g_get_monotonic_time();
+	for(j = 0; j < iterations; j++)
+		for(i = 0; i < services; i++)
+			fill(design, tables[i]);
+	update_ns = elapsed_ns(start, (gdouble)iterations * services *
+			       G_N_ELEMENTS(keys));
+	alloc_count_end(&update_allocations, NULL);
+
+	start = g_get_monotonic_time();
+	for(j = 0; j < iterations; j++) {
+		for(i = 0; i < services; i++) {
+			for(k = 0; k < G_N_ELEMENTS(keys); k++) {
+				if(design->get(tables[i], keys[k][0],
+					       keys[k][1]) != keys[k]) {
+					fprintf(stderr, "%s: lost %s %s\n",
+						design->name, keys[k][0],
+						keys[k][1] ? keys[k][1] : "");
+					return FALSE;
+				}
+			}
+		}
+	}
+	lookup_ns = elapsed_ns(start, (gdouble)iterations * services *
+			       G_N_ELEMENTS(keys));
+
+	for(i = 0; i < services; i++)
+		design->destroy(tables[i]);
+	g_free(tables);
+
+	printf("%s: insert %.1f ns, update %.1f ns, lookup %.1f ns",
+	       design->name, insert_ns, update_ns, lookup_ns);
+	if(alloc_count_supported())
+		printf(", %.1f allocations and %.0f bytes per service, "
+		       "%.2f allocations per update",
+		       (gdouble)allocations / services,
+		       (gdouble)bytes / services,
+		       (gdouble)update_allocations /
+		       ((gdouble)iterations * services * G_N_ELEMENTS(keys)));
+	printf("\n");
+	return TRUE;
+}
+
+static const GOptionEntry options[] = {
+	{ "services", 0, 0, G_OPTION_ARG_INT, &services,
+		"Number of services", "N" },
+	{ "iterations", 0, 0, G_OPTION_ARG_INT, &iterations,
+		"Passes of updates and lookups over every service", "N" },
+	{ NULL }
+};
+
+int main(int argc, char *argv[])
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	guint i;
+
+	context = g_option_context_new(NULL);
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		return 1;
+	}
+	g_option_context_free(context);
+	if(services < 1 || iterations < 1) {
+		fprintf(stderr, "Usage: %s [--services=N] [--iterations=N]\n",
+			argv[0]);
+		return 1;
+	}
+
+	for(i = 0; i < G_N_ELEMENTS(designs); i++)
+		if(!run(&designs[i]))
+			return 1;
+	return 0;
+}
@@ -0,0 +1,453 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs the model the window is built on against the mock daemon on a
+ * private bus, without the window:
+ *
+ *	model-bench ingest  [--services=N]	first GetServices into the model
+ *	model-bench updates [--services=N] [--updates=N] [--rate=N]
+ *	model-bench status  [--services=N]	one status_update()
+ *	model-bench readers [--services=N]	the properties of every row
+ *	model-bench allocations [--services=N]	mallocs of the first ingest
+ *	model-bench memory  [--services=N]	resident memory per service
+ *
+ * The cases are registered with meson, run them with meson test
+ * --benchmark. A case that cannot run here exits with 77.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "alloc.h"
+#include "config.h"
+#include "configurator.h"
+#include "host.h"
+#include "interfaces.h"
+#include "main.h"
+#include "mock.h"
+#include "service.h"
+#include "status.h"
+
+#define BENCH_SKIP 77
+/* Seconds any one wait may take before the case fails */
+#define BENCH_TIMEOUT 120
+
+/* What main.c provides to the rest of the program */
+gboolean shutting_down;
+GtkWidget *main_window;
+struct host *current_host;
+gchar *default_page;
+
+static GMainLoop *loop;
+static struct mock *mock;
+static gchar *bus_address;
+static guint startup_pending;
+static gboolean timed_out;
+
+static gint services = 1000;
+static gint updates = 100000;
+static gint rate;
+static gint iterations = 1000;
+
+void startup_call_begin(void)
+{
+	startup_pending++;
+}
+
+static gboolean check_populated(gpointer user_data)
+{
+	struct host *host = current_host;
+
+	if(!startup_pending && host->technologies_loaded &&
+	   host->services_loaded && !host->pending_services &&
+	   g_hash_table_size(host->services) >= (guint)services)
+		g_main_loop_quit(loop);
+	return G_SOURCE_REMOVE;
+}
+
+/* The replies are applied after this, look once they are */
+void startup_call_done(void)
+{
+	startup_pending--;
+	g_idle_add(check_populated, NULL);
+}
+
+void window_add_technology(struct host *host, struct technology *tech)
+{
+}
+
+void window_technologies_added(struct host *host)
+{
+}
+
+static gboolean bench_timeout(gpointer user_data)
+{
+	timed_out = TRUE;
+	g_main_loop_quit(loop);
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean run(void)
+{
+	guint id;
+
+	id = g_timeout_add_seconds(BENCH_TIMEOUT, bench_timeout, NULL);
+	g_main_loop_run(loop);
+	if(!timed_out)
+		g_source_remove(id);
+	return !timed_out;
+}
+
+static gdouble elapsed_ms(gint64 start)
+{
+	return (gdouble)(g_get_monotonic_time() - start) / 1000;
+}
+
+static gboolean ingest(void)
+{
+	gint64 start = g_get_monotonic_time();
+
+	current_host = host_new(bus_address);
+	host_connect(current_host);
+	if(!run()) {
+		fprintf(stderr, "Timed out waiting for %d services\n",
+			services);
+		return FALSE;
+	}
+	printf("ingest: %d services in %.1f ms, %.2f us per service\n",
+	       services, elapsed_ms(start),
+	       elapsed_ms(start) * 1000 / services);
+	return TRUE;
+}
+
+static gboolean check_sentinel(gpointer user_data)
+{
+	struct service *serv;
+	gchar *name;
+
+	serv = g_hash_table_lookup(current_host->services, user_data);
+	if(!serv)
+		return G_SOURCE_CONTINUE;
+	name = service_get_property_string_raw(serv, "Name", NULL);
+	if(!strcmp(name, MOCK_SENTINEL)) {
+		g_free(name);
+		g_main_loop_quit(loop);
+		return G_SOURCE_REMOVE;
+	}
+	g_free(name);
+	return G_SOURCE_CONTINUE;
+}
+
+static int bench_updates(void)
+{
+	gint64 start;
+	gdouble ms;
+	guint id;
+
+	if(!ingest())
+		return 1;
+
+	start = g_get_monotonic_time();
+	mock_emit_updates(mock, (guint)updates, (guint)rate);
+	id = g_timeout_add(1, check_sentinel,
+			   (gpointer)mock_sentinel_path(mock));
+	if(!run()) {
+		g_source_remove(id);
+		fprintf(stderr, "Timed out waiting for the updates\n");
+		return 1;
+	}
+	ms = elapsed_ms(start);
+	printf("updates: %d PropertyChanged in %.1f ms, %.0f per second\n",
+	       updates, ms, updates * 1000 / ms);
+	if(rate)
+		printf("updates: %.1f ms behind a sender at %d per second\n",
+		       ms - (gdouble)updates * 1000 / rate, rate);
+	return 0;
+}
+
+static int bench_status(void)
+{
+#ifdef USE_STATUS_ICON
+	gint64 start;
+	gint i;
+
+	if(!gtk_init_check(NULL, NULL)) {
+		fprintf(stderr, "No display, skipping\n");
+		return BENCH_SKIP;
+	}
+	status_icon_enabled = TRUE;
+	status_init(NULL);
+	if(!ingest())
+		return 1;
+
+	/* every service is idle, so each call walks all of them */
+	start = g_get_monotonic_time();
+	for(i = 0; i < iterations; i++)
+		status_update();
+	printf("status: %.2f us per status_update() over %d services\n",
+	       elapsed_ms(start) * 1000 / iterations, services);
+	return 0;
+#else
+	fprintf(stderr, "Built without the status icon, skipping\n");
+	return BENCH_SKIP;
+#endif
+}
+
+/*
+ * What a row reads on every update, once as it was looked up from the
+ * property table and once from the decoded fields
+ */
+static guint read_properties(struct service *serv)
+{
+	gchar *state, **security, **cur;
+	guint sum = 0;
+
+	state = service_get_property_string_raw(serv, "State", NULL);
+	if(!strcmp(state, "idle") || !strcmp(state, "disconnect"))
+		sum += 1;
+	else if(!strcmp(state, "failure"))
+		sum += 2;
+	g_free(state);
+	sum += service_get_property_int(serv, "Strength", NULL);
+	sum += service_get_property_boolean(serv, "Favorite", NULL);
+	security = service_get_property_strv(serv, "Security", NULL);
+	for(cur = security; *cur; cur++)
+		if(!strcmp(*cur, "psk"))
+			sum += 4;
+	g_strfreev(security);
+	return sum;
+}
+
+static guint read_fields(struct service *serv)
+{
+	guint sum = 0;
+
+	if(serv->state == SERVICE_STATE_IDLE ||
+	   serv->state == SERVICE_STATE_DISCONNECT)
+		sum += 1;
+	else if(serv->state == SERVICE_STATE_FAILURE)
+		sum += 2;
+	sum += serv->strength;
+	sum += !!(serv->flags & SERVICE_FAVORITE);
+	if(serv->security == SERVICE_SECURITY_PSK)
+		sum += 4;
+	return sum;
+}
+
+static gdouble time_readers(guint (*read)(struct service *serv), guint *sum)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	gint64 start;
+	gint i;
+
+	start = g_get_monotonic_time();
+	for(i = 0; i < iterations; i++) {
+		g_hash_table_iter_init(&iter, current_host->services);
+		while(g_hash_table_iter_next(&iter, &key, &value))
+			*sum += read(value);
+	}
+	return elapsed_ms(start) * 1000000 / ((gdouble)iterations * services);
+}
+
+static int bench_readers(void)
+{
+	guint properties_sum = 0, fields_sum = 0;
+	gdouble properties_ns, fields_ns;
+
+	if(!ingest())
+		return 1;
+
+	properties_ns = time_readers(read_properties, &properties_sum);
+	fields_ns = time_readers(read_fields, &fields_sum);
+	if(properties_sum != fields_sum) {
+		fprintf(stderr, "The fields disagree with the properties\n");
+		return 1;
+	}
+	printf("readers: %.1f ns per row from the properties, %.1f ns from "
+	       "the fields, %.1fx\n", properties_ns, fields_ns,
+	       properties_ns / fields_ns);
+	return 0;
+}
+
+/* Only the main thread is counted, the mock is not the model */
+static int bench_allocations(void)
+{
+	guint64 allocations, bytes;
+
+	if(!alloc_count_supported()) {
+		fprintf(stderr, "Cannot count allocations here, skipping\n");
+		return BENCH_SKIP;
+	}
+	alloc_count_begin();
+	if(!ingest())
+		return 1;
+	alloc_count_end(&allocations, &bytes);
+	printf("allocations: %" G_GUINT64_FORMAT " for %d services, %.0f "
+	       "per 1000 services, %" G_GUINT64_FORMAT " bytes\n",
+	       allocations, services, (gdouble)allocations * 1000 / services,
+	       bytes);
+	return 0;
+}
+
+static gsize resident_bytes(void)
+{
+	unsigned long size, resident = 0;
+	gchar *statm;
+
+	if(!g_file_get_contents("/proc/self/statm", &statm, NULL, NULL))
+		return 0;
+	if(sscanf(statm, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+	g_free(statm);
+	return resident * (gsize)sysconf(_SC_PAGESIZE);
+}
+
+/* Have the mock build and drop one reply so its buffers are not counted */
+static void warm_up(void)
+{
+	GDBusConnection *connection;
+	GVariant *ret;
+
+	connection = g_dbus_connection_new_for_address_sync(bus_address,
+			G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+			G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+			NULL, NULL, NULL);
+	if(!connection)
+		return;
+	ret = g_dbus_connection_call_sync(connection, CONNMAN_PATH, "/",
+					  MANAGER_NAME, "GetServices", NULL,
+					  NULL, G_DBUS_CALL_FLAGS_NONE, -1,
+					  NULL, NULL);
+	if(ret)
+		g_variant_unref(ret);
+	g_dbus_connection_close_sync(connection, NULL, NULL);
+	g_object_unref(connection);
+}
+
+static int bench_memory(void)
+{
+	gsize before, after;
+
+	warm_up();
+	before = resident_bytes();
+	if(!before) {
+		fprintf(stderr, "No /proc/self/statm, skipping\n");
+		return BENCH_SKIP;
+	}
+	if(!ingest())
+		return 1;
+	after = resident_bytes();
+	printf("memory: %" G_GSIZE_FORMAT " kB for %d services, "
+	       "%" G_GSIZE_FORMAT " bytes per service\n",
+	       (after - before) / 1024, services,
+	       (after - before) / (gsize)services);
+	return 0;
+}
+
+static const GOptionEntry options[] = {
+	{ "services", 0, 0, G_OPTION_ARG_INT, &services,
+		"Number of wireless services", "N" },
+	{ "updates", 0, 0, G_OPTION_ARG_INT, &updates,
+		"Number of PropertyChanged signals", "N" },
+	{ "rate", 0, 0, G_OPTION_ARG_INT, &rate,
+		"Signals per second, as fast as possible by default", "N" },
+	{ "iterations", 0, 0, G_OPTION_ARG_INT, &iterations,
+		"Number of status_update() calls or passes over the rows",
+		"N" },
+	{ NULL }
+};
+
+int main(int argc, char *argv[])
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	GTestDBus *bus;
+	gchar *daemon;
+	int status;
+
+	context = g_option_context_new("ingest|updates|status|readers|"
+				       "allocations|memory");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		return 1;
+	}
+	g_option_context_free(context);
+	if(argc != 2 || services < 1 || updates < 1 || rate < 0 ||
+	   iterations < 1) {
+		fprintf(stderr, "Usage: %s "
+			"ingest|updates|status|readers|allocations|memory "
+			"[--services=N]\n", argv[0]);
+		return 1;
+	}
+
+	daemon = g_find_program_in_path("dbus-daemon");
+	if(!daemon) {
+		fprintf(stderr, "No dbus-daemon, skipping\n");
+		return BENCH_SKIP;
+	}
+	g_free(daemon);
+
+	bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+	g_test_dbus_up(bus);
+	bus_address = g_strdup(g_test_dbus_get_bus_address(bus));
+
+	interfaces_init();
+	mock = mock_new(bus_address);
+	mock_add_technology(mock, "ethernet", TRUE);
+	mock_add_technology(mock, "wifi", TRUE);
+	mock_add_services(mock, "wifi", (guint)services);
+	loop = g_main_loop_new(NULL, FALSE);
+
+	if(!mock_start(mock))
+		status = 1;
+	else if(!strcmp(argv[1], "ingest"))
+		status = ingest() ? 0 : 1;
+	else if(!strcmp(argv[1], "updates"))
+		status = bench_updates();
+	else if(!strcmp(argv[1], "status"))
+		status = bench_status();
+	else if(!strcmp(argv[1], "readers"))
+		status = bench_readers();
+	else if(!strcmp(argv[1], "allocations"))
+		status = bench_allocations();
+	else if(!strcmp(argv[1], "memory"))
+		status = bench_memory();
+	else
+		status = 1;
+
+	/* the model is left for the process exit to reclaim */
+	mock_free(mock);
+	g_main_loop_unref(loop);
+	g_test_dbus_down(bus);
+	g_object_unref(bus);
+	g_free(bus_address);
+	return status;
+}
@@ -0,0 +1,299 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compares main thread CPU time spent on ConnMan style signals when they
+ * are unpacked in the GDBus callback on the main thread against handing
+ * the decoded records over from the router worker.
+ *
+ * Needs a session bus, e.g. dbus-run-session ./router-bench [signals],
+ * without one it exits with 77 so meson test --benchmark skips it.
+ */
+
+/* for CLOCK_THREAD_CPUTIME_ID under -std=c11 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "router.h"
+
+#define BENCH_SERVICES 16
+#define BENCH_BATCH 8
+
+static GMainLoop *loop;
+static GHashTable *properties;
+static guint received, expected;
+
+static gint64 thread_cpu_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (gint64)ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static gchar *service_path(guint i)
+{
+	return g_strdup_printf("/net/connman/service/wifi_%u", i);
+}
+
+/* Stands in for service_update(), one table write per property */
+static void apply_property(const gchar *path, const gchar *name,
+			   GVariant *value)
+{
+	g_hash_table_replace(properties, g_strconcat(path, name, NULL),
+			     g_variant_ref(value));
+}
+
+static void apply_properties(const gchar *path, GVariant *dict)
+{
+	GVariantIter iter;
+	const gchar *name;
+	GVariant *value;
+
+	g_variant_iter_init(&iter, dict);
+	while(g_variant_iter_next(&iter, "{&sv}", &name, &value)) {
+		apply_property(path, name, value);
+		g_variant_unref(value);
+	}
+}
+
+static void signal_received(void)
+{
+	if(++received == expected)
+		g_main_loop_quit(loop);
+}
+
+/* The handlers as they were before the router worker */
+static void inline_signal(GDBusConnection *connection, const gchar *sender,
+			  const gchar *path, const gchar *interface,
+			  const gchar *signal, GVariant *parameters,
+			  gpointer user_data)
+{
+	if(!strcmp(signal, "PropertyChanged")) {
+		GVariant *name_v, *value_v, *value;
+
+		name_v = g_variant_get_child_value(parameters, 0);
+		value_v = g_variant_get_child_value(parameters, 1);
+		value = g_variant_get_child_value(value_v, 0);
+		apply_property(path, g_variant_get_string(name_v, NULL),
+			       value);
+		g_variant_unref(value);
+		g_variant_unref(name_v);
+		g_variant_unref(value_v);
+	} else if(!strcmp(signal, "ServicesChanged")) {
+		GVariant *modified, *value;
+		GVariantIter *iter;
+		gchar *object;
+
+		modified = g_variant_get_child_value(parameters, 0);
+		iter = g_variant_iter_new(modified);
+		while(g_variant_iter_loop(iter, "(o@*)", &object, &value))
+			apply_properties(object, value);
+		g_variant_iter_free(iter);
+		g_variant_unref(modified);
+	}
+	signal_received();
+}
+
+static void routed_signal(const struct router_delta *delta,
+			  gpointer user_data)
+{
+	if(delta->kind == ROUTER_DELTA_PROPERTY)
+		apply_property(delta->path, delta->property, delta->value);
+	else if(delta->kind == ROUTER_DELTA_CHANGED)
+		apply_properties(delta->object, delta->value);
+	if(delta->last)
+		signal_received();
+}
+
+static GVariant *services_changed(guint first)
+{
+	GVariantBuilder modified;
+	guint i;
+
+	g_variant_builder_init(&modified, G_VARIANT_TYPE("a(oa{sv})"));
+	for(i = 0; i < BENCH_BATCH; i++) {
+		GVariantBuilder dict;
+		gchar *path = service_path((first + i) % BENCH_SERVICES);
+
+		g_variant_builder_init(&dict, G_VARIANT_TYPE("a{sv}"));
+		g_variant_builder_add(&dict, "{sv}", "Strength",
+				      g_variant_new_byte((guchar)(first + i)));
+		g_variant_builder_add(&dict, "{sv}", "State",
+				      g_variant_new_string("idle"));
+		g_variant_builder_add(&modified, "(o@a{sv})", path,
+				      g_variant_builder_end(&dict));
+		g_free(path);
+	}
+	return g_variant_new("(@a(oa{sv})@ao)",
+			     g_variant_builder_end(&modified),
+			     g_variant_new_objv(NULL, 0));
+}
+
+/* One in ten signals is a ServicesChanged, as seen while roaming */
+static gpointer emit_signals(gpointer user_data)
+{
+	GDBusConnection *emitter = user_data;
+	guint i;
+
+	for(i = 0; i < expected; i++) {
+		GError *error = NULL;
+
+		if(i % 10 == 9) {
+			g_dbus_connection_emit_signal(emitter, NULL, "/",
+						      "net.connman.Manager",
+						      "ServicesChanged",
+						      services_changed(i),
+						      &error);
+		} else {
+			gchar *path = service_path(i % BENCH_SERVICES);
+
+			g_dbus_connection_emit_signal(emitter, NULL, path,
+						      "net.connman.Service",
+						      "PropertyChanged",
+						      g_variant_new("(sv)",
+							"Strength",
+							g_variant_new_byte(
+								(guchar)i)),
+						      &error);
+			g_free(path);
+		}
+		if(error) {
+			g_critical("Failed to emit: %s", error->message);
+			g_error_free(error);
+		}
+	}
+	g_dbus_connection_flush_sync(emitter, NULL, NULL);
+	return NULL;
+}
+
+/* Make sure the bus has seen the match rule before emitting */
+static void sync_bus(GDBusConnection *connection)
+{
+	GVariant *ret;
+
+	ret = g_dbus_connection_call_sync(connection, "org.freedesktop.DBus",
+					  "/org/freedesktop/DBus",
+					  "org.freedesktop.DBus", "GetId",
+					  NULL, NULL, G_DBUS_CALL_FLAGS_NONE,
+					  -1, NULL, NULL);
+	if(ret)
+		g_variant_unref(ret);
+}
+
+static gint64 run(GDBusConnection *connection, GDBusConnection *emitter,
+		  gboolean routed)
+{
+	const gchar *name = g_dbus_connection_get_unique_name(emitter);
+	struct router *router = NULL;
+	guint id = 0, i;
+	gint64 start;
+	GThread *thread;
+
+	received = 0;
+	properties = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					   (GDestroyNotify)g_variant_unref);
+
+	if(routed) {
+		router = router_new(connection);
+		router_subscribe(router, name);
+		router_add(router, name, "/", routed_signal, NULL);
+		for(i = 0; i < BENCH_SERVICES; i++) {
+			gchar *path = service_path(i);
+
+			router_add(router, name, path, routed_signal, NULL);
+			g_free(path);
+		}
+		while(!router_match_rule_count())
+			g_usleep(1000);
+	} else {
+		id = g_dbus_connection_signal_subscribe(connection, name, NULL,
+							NULL, NULL, NULL,
+						G_DBUS_SIGNAL_FLAGS_NONE,
+							inline_signal, NULL,
+							NULL);
+	}
+	sync_bus(connection);
+
+	start = thread_cpu_us();
+	thread = g_thread_new("emitter", emit_signals, emitter);
+	g_main_loop_run(loop);
+	start = thread_cpu_us() - start;
+	g_thread_join(thread);
+
+	if(router)
+		router_free(router);
+	else
+		g_dbus_connection_signal_unsubscribe(connection, id);
+	g_hash_table_unref(properties);
+	return start;
+}
+
+int main(int argc, char *argv[])
+{
+	GDBusConnection *connection, *emitter;
+	GError *error = NULL;
+	gchar *address;
+	gint64 inline_us, routed_us;
+
+	expected = argc > 1 ? (guint)atoi(argv[1]) : 10000;
+	if(!expected)
+		expected = 10000;
+
+	connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
+	if(!connection) {
+		fprintf(stderr, "No session bus, skipping: %s\n",
+			error->message);
+		g_error_free(error);
+		return 77;
+	}
+	address = g_dbus_address_get_for_bus_sync(G_BUS_TYPE_SESSION, NULL,
+						  NULL);
+	emitter = g_dbus_connection_new_for_address_sync(address,
+				G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+				G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+				NULL, NULL, &error);
+	g_free(address);
+	if(!emitter) {
+		fprintf(stderr, "No second connection: %s\n", error->message);
+		return 1;
+	}
+
+	loop = g_main_loop_new(NULL, FALSE);
+	inline_us = run(connection, emitter, FALSE);
+	routed_us = run(connection, emitter, TRUE);
+
+	printf("%u signals, main thread CPU per 1000 signals\n", expected);
+	printf("main thread decoding\t%.1f ms\n",
+	       (double)inline_us / expected);
+	printf("router worker\t\t%.1f ms\n", (double)routed_us / expected);
+
+	g_main_loop_unref(loop);
+	g_object_unref(emitter);
+	g_object_unref(connection);
+	return 0;
+}
@@ -29,15 +29,17 @@
 #include "dialog.h"
 #include "interfaces.h"
 #include "main.h"
+#include "probes.h"
+#include "stats.h"
 #include "style.h"
 #include "openconnect_helper.h"
 
-GDBusConnection *conn = NULL;
-
+/* Every host registers its own agents on its own connection */
 struct agent {
+	GDBusConnection *connection;
 	gint id;
 	const gchar *cancel;
-} *normal_agent, *vpn_agent;
+};
 
 static void release(struct agent *agent, GDBusMethodInvocation *invocation)
 {
@@ -152,8 +154,11 @@ static gpointer request_input(gpointer data)
 	GVariantDict *dict = NULL;
 	GVariant *ret, *ret_v;
 	GPtrArray *entries = NULL;
+	const gchar *path;
 	int success = 0;
 
+	g_variant_get_child(parameters, 0, "&o", &path);
+	PROBE_DIALOG_OPEN(path);
 	if(!is_openconnect(parameters)) {
 		entries = generate_entries(parameters);
 		success = dialog_ask_tokens(_("Authentication required"),
@@ -164,6 +169,7 @@ static gpointer request_input(gpointer data)
 	else
 		dict = openconnect_handle(invocation, parameters);
 
+	PROBE_DIALOG_CLOSE(path, dict ? "ok" : "cancel");
 	if(!dict) {
 		g_dbus_method_invocation_return_dbus_error(invocation,
 				agent->cancel, "User canceled password dialog");
@@ -213,6 +219,8 @@ static void method_call(GDBusConnection *connection, const gchar *sender,
 			const gchar *method_name, GVariant *parameters,
 			GDBusMethodInvocation *invocation, gpointer user_data)
 {
+	gint64 start = stats_begin();
+
 	if(!strcmp(method_name, "Release"))
 		release(user_data, invocation);
 	else if(!strcmp(method_name, "ReportError"))
@@ -227,6 +235,7 @@ static void method_call(GDBusConnection *connection, const gchar *sender,
 		request_peer_authorization(user_data, invocation, parameters);
 	else
 		cancel(invocation);
+	stats_end(STATS_AGENT_METHOD_CALL, start);
 }
 
 static char *agent_path(void)
@@ -252,86 +261,86 @@ static const GDBusInterfaceVTable vtable = {
 	NULL
 };
 
-static struct agent *agent_create(GDBusConnection *connection,
-				  GDBusProxy *manager,
-				  const gchar *interface_name,
-				  const gchar *agent_path, const gchar *path,
-				  const gchar *cancel)
+static void register_agent_cb(GObject *source, GAsyncResult *res,
+			      gpointer user_data)
 {
+	struct agent **slot = user_data;
 	GError *error = NULL;
-	struct agent *agent;
 	GVariant *ret;
-	GDBusNodeInfo *info;
-	GDBusInterfaceInfo *interface;
 
-	info = g_dbus_node_info_new_for_xml(interface_name, &error);
+	ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res,
+					    &error);
+	startup_call_done();
 	if(error) {
-		g_critical("Failed to load agent interface: %s",
-		           error->message);
+		/* the agent was already released if the call was cancelled */
+		if(!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_critical("Failed to register agent: %s",
+				   error->message);
+			agent_release(slot);
+		}
 		g_error_free(error);
-		return NULL;
+		return;
 	}
+	g_variant_unref(ret);
+}
+
+static void agent_create(struct agent **slot, GDBusConnection *connection,
+			 const gchar *bus_name, const gchar *manager,
+			 enum interface_id interface, const gchar *path,
+			 const gchar *cancel, GCancellable *cancellable)
+{
+	GError *error = NULL;
+	struct agent *agent;
 
 	agent = g_malloc(sizeof(*agent));
-	interface = g_dbus_node_info_lookup_interface(info, agent_path),
 	agent->id = g_dbus_connection_register_object(connection, path,
-						      interface, &vtable, agent,
-						      NULL, &error);
-	conn = connection;
-	g_dbus_node_info_unref(info);
+						      interface_info(interface),
+						      &vtable, agent, NULL,
+						      &error);
 	if(error) {
 		g_critical("Failed to register agent object: %s",
 		           error->message);
 		g_error_free(error);
 		g_free(agent);
-		return NULL;
+		*slot = NULL;
+		return;
 	}
 
-	ret = g_dbus_proxy_call_sync(manager, "RegisterAgent",
-	                             g_variant_new("(o)", path),
-	                             G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
-	if(error) {
-		g_critical("Failed to register agent: %s",
-		           error->message);
-		g_error_free(error);
-		g_free(agent);
-		return NULL;
-	}
-	g_variant_unref(ret);
-
+	agent->connection = g_object_ref(connection);
 	agent->cancel = cancel;
-	return agent;
-}
-
+	*slot = agent;
 
-void register_agent(GDBusConnection *connection, GDBusProxy *manager)
-{
-	normal_agent = agent_create(connection, manager, AGENT_INTERFACE,
-				    AGENT_NAME, agent_path(),
-				    "net.connman.Agent.Error.Canceled");
+	startup_call_begin();
+	g_dbus_connection_call(connection, bus_name, "/", manager,
+			       "RegisterAgent", g_variant_new("(o)", path),
+			       NULL, G_DBUS_CALL_FLAGS_NONE, -1, cancellable,
+			       register_agent_cb, slot);
 }
 
-void register_vpn_agent(GDBusConnection *connection, GDBusProxy *vpn_manager)
+void register_agent(struct agent **slot, GDBusConnection *connection,
+		    GCancellable *cancellable)
 {
-	vpn_agent  = agent_create(connection, vpn_manager, VPN_AGENT_INTERFACE,
-				  VPN_AGENT_NAME, vpn_agent_path(),
-				  "net.connman.vpn.Agent.Error.Canceled");
+	agent_create(slot, connection, CONNMAN_PATH, MANAGER_NAME,
+		     INTERFACE_AGENT, agent_path(),
+		     "net.connman.Agent.Error.Canceled", cancellable);
 }
 
-void agent_release(void)
+void register_vpn_agent(struct agent **slot, GDBusConnection *connection,
+			GCancellable *cancellable)
 {
-	if(conn && normal_agent) {
-		g_dbus_connection_unregister_object(conn, normal_agent->id);
-		g_free(normal_agent);
-	}
-	normal_agent = NULL;
+	agent_create(slot, connection, CONNMAN_VPN_PATH,
+		     VPN_MANAGER_NAME, INTERFACE_VPN_AGENT, vpn_agent_path(),
+		     "net.connman.vpn.Agent.Error.Canceled", cancellable);
 }
 
-void vpn_agent_release(void)
+void agent_release(struct agent **slot)
 {
-	if(conn && vpn_agent) {
-		g_dbus_connection_unregister_object(conn, vpn_agent->id);
-		g_free(vpn_agent);
-	}
-	vpn_agent = NULL;
+	struct agent *agent = *slot;
+
+	if(!agent)
+		return;
+	g_dbus_connection_unregister_object(agent->connection, agent->id);
+	g_object_unref(agent->connection);
+	g_free(agent);
+	*slot = NULL;
 }
@@ -23,9 +23,12 @@
 
 #include <gio/gio.h>
 
-void register_agent(GDBusConnection *connection, GDBusProxy *manager);
-void register_vpn_agent(GDBusConnection *connection, GDBusProxy *vpn_manager);
-void agent_release(void);
-void vpn_agent_release(void);
+struct agent;
+
+void register_agent(struct agent **slot, GDBusConnection *connection,
+		    GCancellable *cancellable);
+void register_vpn_agent(struct agent **slot, GDBusConnection *connection,
+			GCancellable *cancellable);
+void agent_release(struct agent **slot);
 
 #endif /* _CONNMAN_GTK_AGENT_H */
@@ -0,0 +1,141 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "binding.h"
+#include "util.h"
+
+struct binding {
+	binding_func update;
+	gpointer user_data;
+	GDestroyNotify destroy;
+	gboolean dirty;
+};
+
+struct binding_set {
+	GPtrArray *bindings;
+	/* (key, subkey) to the bindings depending on it */
+	DualHashTable *dependents;
+	GPtrArray *dirty;
+};
+
+static void binding_free(gpointer data)
+{
+	struct binding *binding = data;
+
+	if(binding->destroy)
+		binding->destroy(binding->user_data);
+	g_free(binding);
+}
+
+struct binding_set *binding_set_new(void)
+{
+	struct binding_set *set = g_malloc(sizeof(*set));
+
+	set->bindings = g_ptr_array_new_with_free_func(binding_free);
+	set->dependents = dual_hash_table_new(
+					(GDestroyNotify)g_ptr_array_unref);
+	set->dirty = g_ptr_array_new();
+	return set;
+}
+
+void binding_set_free(struct binding_set *set)
+{
+	if(!set)
+		return;
+	dual_hash_table_unref(set->dependents);
+	g_ptr_array_unref(set->dirty);
+	g_ptr_array_unref(set->bindings);
+	g_free(set);
+}
+
+struct binding *binding_add(struct binding_set *set, binding_func update,
+                            gpointer user_data, GDestroyNotify destroy)
+{
+	struct binding *binding = g_malloc(sizeof(*binding));
+
+	binding->update = update;
+	binding->user_data = user_data;
+	binding->destroy = destroy;
+	binding->dirty = FALSE;
+	g_ptr_array_add(set->bindings, binding);
+	return binding;
+}
+
+void binding_depend(struct binding_set *set, struct binding *binding,
+                    const gchar *key, const gchar *subkey)
+{
+	GPtrArray *dependents;
+
+	dependents = hash_table_get_dual_key(set->dependents, key, subkey);
+	if(!dependents) {
+		dependents = g_ptr_array_new();
+		hash_table_set_dual_key(set->dependents, key, subkey,
+					dependents);
+	}
+	g_ptr_array_add(dependents, binding);
+}
+
+void binding_set_changed(struct binding_set *set, const gchar *key,
+                         const gchar *subkey)
+{
+	GPtrArray *dependents;
+	guint i;
+
+	dependents = hash_table_get_dual_key(set->dependents, key, subkey);
+	if(!dependents)
+		return;
+	for(i = 0; i < dependents->len; i++) {
+		struct binding *binding = g_ptr_array_index(dependents, i);
+
+		if(binding->dirty)
+			continue;
+		binding->dirty = TRUE;
+		g_ptr_array_add(set->dirty, binding);
+	}
+}
+
+/* A binding marking others while it runs has them run in the same flush */
+void binding_set_flush(struct binding_set *set)
+{
+	guint i;
+
+	for(i = 0; i < set->dirty->len; i++) {
+		struct binding *binding = g_ptr_array_index(set->dirty, i);
+
+		binding->dirty = FALSE;
+		binding->update(binding->user_data);
+	}
+	g_ptr_array_set_size(set->dirty, 0);
+}
+
+void binding_set_update_all(struct binding_set *set)
+{
+	guint i;
+
+	for(i = 0; i < set->bindings->len; i++) {
+		struct binding *binding = g_ptr_array_index(set->bindings, i);
+
+		binding->dirty = FALSE;
+		binding->update(binding->user_data);
+	}
+	g_ptr_array_set_size(set->dirty, 0);
+}
@@ -0,0 +1,48 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_BINDING_H
+#define _CONNMAN_GTK_BINDING_H
+
+#include <glib.h>
+
+struct binding;
+struct binding_set;
+
+typedef void (*binding_func)(gpointer user_data);
+
+/*
+ * A binding redraws one widget from the properties it depends on. When a
+ * (key, subkey) pair changes, only the bindings depending on it are
+ * marked, and a flush runs each marked binding once, however many of its
+ * inputs changed since the last flush.
+ */
+struct binding_set *binding_set_new(void);
+void binding_set_free(struct binding_set *set);
+struct binding *binding_add(struct binding_set *set, binding_func update,
+                            gpointer user_data, GDestroyNotify destroy);
+void binding_depend(struct binding_set *set, struct binding *binding,
+                    const gchar *key, const gchar *subkey);
+void binding_set_changed(struct binding_set *set, const gchar *key,
+                         const gchar *subkey);
+void binding_set_flush(struct binding_set *set);
+void binding_set_update_all(struct binding_set *set);
+
+#endif /* _CONNMAN_GTK_BINDING_H */
@@ -44,21 +44,37 @@ enum connection_type connection_type_from_string(const gchar *str)
 	return CONNECTION_TYPE_UNKNOWN;
 }
 
-enum connection_type connection_type_from_properties(GVariant *properties)
+/* The Type ConnMan uses, VPN connections are all "vpn" */
+const gchar *connection_type_name(enum connection_type type)
 {
-	enum connection_type type = CONNECTION_TYPE_UNKNOWN;
-	GVariantDict *dict = g_variant_dict_new(properties);
-	GVariant *type_v = g_variant_dict_lookup_value(dict, "Type", NULL);
-	if(type_v) {
-		const gchar *type_s;
-
-		type_s = g_variant_get_string(type_v, NULL);
-		type = connection_type_from_string(type_s);
-		g_variant_unref(type_v);
+	switch(type) {
+	case CONNECTION_TYPE_ETHERNET:
+		return "ethernet";
+	case CONNECTION_TYPE_WIRELESS:
+		return "wifi";
+	case CONNECTION_TYPE_BLUETOOTH:
+		return "bluetooth";
+	case CONNECTION_TYPE_CELLULAR:
+		return "cellular";
+	case CONNECTION_TYPE_P2P:
+		return "p2p";
+	case CONNECTION_TYPE_VPN:
+		return "vpn";
+	case CONNECTION_TYPE_UNKNOWN:
+	case CONNECTION_TYPE_COUNT:
+		return "unknown";
 	}
-	g_variant_dict_unref(dict);
+	return "unknown";
+}
+
+enum connection_type connection_type_from_properties(GVariant *properties)
+{
+	const gchar *type;
 
-	return type;
+	/* read from the serialized dictionary, nothing is copied */
+	if(!g_variant_lookup(properties, "Type", "&s", &type))
+		return CONNECTION_TYPE_UNKNOWN;
+	return connection_type_from_string(type);
 }
 
 const gchar *translated_tech_name(enum connection_type type)
@@ -33,6 +33,7 @@ enum connection_type {
 };
 
 enum connection_type connection_type_from_string(const gchar *str);
+const gchar *connection_type_name(enum connection_type type);
 enum connection_type connection_type_from_properties(GVariant *properties);
 const gchar *translated_tech_name(enum connection_type type);
 const gchar *mnemonic_tech_name(enum connection_type type);
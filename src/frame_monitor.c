@@ -0,0 +1,222 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "frame_monitor.h"
+#include "router.h"
+
+/*
+ * Follows the frame clock of a window and writes a line per frame: the
+ * time since the previous frame, the frames that should have been drawn
+ * in between, how long the frame itself took from update to paint, and
+ * the router batches and records the main thread handled since the
+ * previous frame, which is what the frame had to wait for.
+ *
+ * The clock stops when there is nothing to draw, so a long gap is only a
+ * dropped frame when it is shorter than FRAME_IDLE.
+ */
+
+#define FRAME_IDLE (250 * 1000)
+
+gchar *frame_log;
+
+struct frame_window {
+	gchar *label;
+	GdkFrameClock *clock;
+	gulong update_id;
+	gulong after_paint_id;
+
+	gint64 last_frame;
+	gint64 update_start;
+	guint64 batches;
+	guint64 deltas;
+	gint64 drain_time;
+
+	/* ms between frames, for the summary */
+	GArray *intervals;
+	guint dropped;
+};
+
+static FILE *log_file;
+static GSList *windows;
+
+static void frame_update(GdkFrameClock *clock, gpointer user_data)
+{
+	struct frame_window *win = user_data;
+
+	win->update_start = g_get_monotonic_time();
+}
+
+static void frame_after_paint(GdkFrameClock *clock, gpointer user_data)
+{
+	struct frame_window *win = user_data;
+	gint64 frame_time = gdk_frame_clock_get_frame_time(clock);
+	gint64 refresh = 0, interval = 0, drain_time;
+	guint64 batches, deltas;
+	guint dropped = 0;
+	gdouble ms;
+
+	if(!log_file)
+		return;
+	router_drain_totals(&batches, &deltas, &drain_time);
+	gdk_frame_clock_get_refresh_info(clock, frame_time, &refresh, NULL);
+	if(win->last_frame) {
+		interval = frame_time - win->last_frame;
+		if(refresh && interval < FRAME_IDLE &&
+		   interval > refresh + refresh / 2)
+			dropped = (guint)((interval + refresh / 2) / refresh - 1);
+		ms = (gdouble)interval / 1000;
+		g_array_append_val(win->intervals, ms);
+		win->dropped += dropped;
+	}
+
+	fprintf(log_file, "%s,%" G_GINT64_FORMAT ",%.2f,%u,%.2f,%"
+		G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%.2f\n", win->label,
+		gdk_frame_clock_get_frame_counter(clock),
+		(gdouble)interval / 1000, dropped,
+		win->update_start ? (gdouble)(g_get_monotonic_time() -
+					      win->update_start) / 1000 : 0.0,
+		batches - win->batches, deltas - win->deltas,
+		(gdouble)(drain_time - win->drain_time) / 1000);
+
+	win->last_frame = frame_time;
+	win->update_start = 0;
+	win->batches = batches;
+	win->deltas = deltas;
+	win->drain_time = drain_time;
+}
+
+static gint compare_double(gconstpointer a, gconstpointer b)
+{
+	gdouble x = *(const gdouble *)a, y = *(const gdouble *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static gdouble percentile(GArray *values, guint p)
+{
+	guint rank = (values->len * p + 99) / 100;
+
+	return g_array_index(values, gdouble, rank ? rank - 1 : 0);
+}
+
+static void window_summary(struct frame_window *win)
+{
+	if(!win->intervals->len)
+		return;
+	g_array_sort(win->intervals, compare_double);
+	g_message("%s window: %u frames, %u dropped, between frames p50 "
+		  "%.1f ms, p95 %.1f ms, p99 %.1f ms", win->label,
+		  win->intervals->len + 1, win->dropped,
+		  percentile(win->intervals, 50),
+		  percentile(win->intervals, 95),
+		  percentile(win->intervals, 99));
+}
+
+static void window_free(struct frame_window *win)
+{
+	window_summary(win);
+	if(win->clock) {
+		g_signal_handler_disconnect(win->clock, win->update_id);
+		g_signal_handler_disconnect(win->clock, win->after_paint_id);
+		g_object_unref(win->clock);
+	}
+	g_array_free(win->intervals, TRUE);
+	g_free(win->label);
+	g_free(win);
+}
+
+static void window_realized(GtkWidget *window, gpointer user_data)
+{
+	struct frame_window *win = user_data;
+
+	win->clock = g_object_ref(gtk_widget_get_frame_clock(window));
+	win->update_id = g_signal_connect(win->clock, "update",
+					  G_CALLBACK(frame_update), win);
+	win->after_paint_id = g_signal_connect(win->clock, "after-paint",
+					       G_CALLBACK(frame_after_paint),
+					       win);
+	router_drain_totals(&win->batches, &win->deltas, &win->drain_time);
+}
+
+static void window_unrealized(GtkWidget *window, gpointer user_data)
+{
+	windows = g_slist_remove(windows, user_data);
+	window_free(user_data);
+}
+
+static gboolean open_log(void)
+{
+	if(log_file)
+		return TRUE;
+	if(!strcmp(frame_log, "-")) {
+		log_file = stdout;
+	} else {
+		log_file = fopen(frame_log, "w");
+		if(!log_file) {
+			g_warning("Failed to open frame log %s", frame_log);
+			g_clear_pointer(&frame_log, g_free);
+			return FALSE;
+		}
+		/* connman-gtk-mock --ramp follows the log as it is written */
+		setvbuf(log_file, NULL, _IOLBF, 0);
+	}
+	fprintf(log_file, "window,frame,interval_ms,dropped,frame_ms,"
+		"batches,records,drain_ms\n");
+	return TRUE;
+}
+
+void frame_monitor_attach(GtkWidget *window, const gchar *label)
+{
+	struct frame_window *win;
+
+	if(!frame_log || !open_log())
+		return;
+
+	win = g_malloc0(sizeof(*win));
+	win->label = g_strdup(label);
+	win->intervals = g_array_new(FALSE, FALSE, sizeof(gdouble));
+	windows = g_slist_prepend(windows, win);
+	g_signal_connect(window, "realize", G_CALLBACK(window_realized), win);
+	g_signal_connect(window, "unrealize", G_CALLBACK(window_unrealized),
+			 win);
+}
+
+static void close_window(gpointer data, gpointer user_data)
+{
+	struct frame_window *win = data;
+
+	window_summary(win);
+	g_array_set_size(win->intervals, 0);
+}
+
+/* Summaries of the windows still open, nothing is logged after this */
+void frame_monitor_close(void)
+{
+	g_slist_foreach(windows, close_window, NULL);
+	if(log_file && log_file != stdout)
+		fclose(log_file);
+	log_file = NULL;
+}
@@ -0,0 +1,32 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_FRAME_MONITOR_H
+#define _CONNMAN_GTK_FRAME_MONITOR_H
+
+#include <gtk/gtk.h>
+
+/* Log every frame of the monitored windows here, "-" for stdout */
+extern gchar *frame_log;
+
+void frame_monitor_attach(GtkWidget *window, const gchar *label);
+void frame_monitor_close(void);
+
+#endif /* _CONNMAN_GTK_FRAME_MONITOR_H */
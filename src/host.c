@@ -0,0 +1,849 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gtk/gtk.h>
+
+#include "config.h"
+#include "agent.h"
+#include "dialog.h"
+#include "host.h"
+#include "interfaces.h"
+#include "main.h"
+#include "probes.h"
+#include "profile.h"
+#include "redraw.h"
+#include "service.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "style.h"
+#include "technology.h"
+#include "trace.h"
+#include "util.h"
+#include "vpn.h"
+
+/* Seconds a restarted daemon has to report its objects again */
+#define RESYNC_GRACE 10
+
+static void host_status_update(struct host *host)
+{
+	if(host == current_host)
+		redraw_status();
+}
+
+/* Row showing the object, NULL unless the host is shown in the window */
+static GtkWidget *stale_widget(struct host *host, const gchar *path)
+{
+	enum connection_type *type;
+	struct service *serv;
+
+	type = g_hash_table_lookup(host->technology_types, path);
+	if(type && host->technologies[*type] &&
+	   host->technologies[*type]->list_item)
+		return host->technologies[*type]->list_item->item;
+	serv = g_hash_table_lookup(host->services, path);
+	if(serv)
+		return serv->item;
+	return NULL;
+}
+
+static void apply_stale(gpointer key, gpointer value, gpointer user_data)
+{
+	GtkWidget *widget = stale_widget(user_data, key);
+
+	if(widget)
+		style_set_stale(widget, TRUE);
+}
+
+void host_apply_stale(struct host *host)
+{
+	g_hash_table_foreach(host->stale_paths, apply_stale, host);
+}
+
+static void set_technology_stale(struct host *host, const gchar *path,
+				 gboolean stale)
+{
+	enum connection_type *type;
+
+	type = g_hash_table_lookup(host->technology_types, path);
+	if(type && host->technologies[*type])
+		technology_set_stale(host->technologies[*type], stale);
+}
+
+static void mark_stale(gpointer key, gpointer value, gpointer user_data)
+{
+	struct host *host = user_data;
+
+	g_hash_table_add(host->stale_paths, (gpointer)path_intern(key));
+	set_technology_stale(host, key, TRUE);
+	apply_stale(key, NULL, host);
+}
+
+static void clear_stale(struct host *host, const gchar *path)
+{
+	GtkWidget *widget;
+
+	if(!g_hash_table_remove(host->stale_paths, path))
+		return;
+	set_technology_stale(host, path, FALSE);
+	widget = stale_widget(host, path);
+	if(widget)
+		style_set_stale(widget, FALSE);
+}
+
+/* Services left behind by a technology of the same type that was freed */
+static void attach_orphans(struct host *host, struct technology *tech)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, host->services);
+	while(g_hash_table_iter_next(&iter, NULL, &value)) {
+		struct service *serv = value;
+
+		if(serv->tech || serv->type != tech->type)
+			continue;
+		serv->tech = tech;
+		technology_add_service(tech, serv);
+	}
+}
+
+/* A technology from the snapshot is stale before its page is built */
+static void add_technology(struct host *host, const gchar *object_path,
+			   GVariant *properties, gboolean stale)
+{
+	struct technology *item;
+
+	if(g_hash_table_contains(host->technology_types, object_path)) {
+		enum connection_type *type;
+
+		type = g_hash_table_lookup(host->technology_types,
+					   object_path);
+		technology_update(host->technologies[*type], properties);
+		clear_stale(host, object_path);
+		return;
+	}
+
+	item = technology_create(host->router, object_path, properties);
+	g_hash_table_insert(host->technology_types,
+			    (gpointer)path_intern(object_path), &item->type);
+	host->technologies[item->type] = item;
+	attach_orphans(host, item);
+	if(stale)
+		mark_stale((gpointer)object_path, NULL, host);
+
+	window_add_technology(host, item);
+	if(stale)
+		apply_stale((gpointer)object_path, NULL, host);
+}
+
+static void remove_technology_by_path(struct host *host, const gchar *path)
+{
+	enum connection_type *type_p;
+	enum connection_type type;
+
+	type_p = g_hash_table_lookup(host->technology_types, path);
+
+	if(!type_p)
+		return;
+	type = *type_p;
+	g_hash_table_remove(host->technology_types, path);
+	technology_free(host->technologies[type]);
+	host->technologies[type] = NULL;
+}
+
+static void add_service(struct host *host, const gchar *path,
+                        GVariant *properties)
+{
+	struct technology *tech;
+	struct service *serv;
+	enum connection_type type;
+
+	PROBE_SERVICE_ADDED(path);
+	type = connection_type_from_properties(properties);
+	tech = host->technologies[type];
+	serv = service_create(tech, host->router, path, properties);
+	g_hash_table_insert(host->services, (gpointer)path_intern(path), serv);
+	if(tech)
+		technology_add_service(tech, serv);
+}
+
+void modify_service(struct host *host, const gchar *path,
+                    GVariant *properties)
+{
+	enum connection_type type;
+	struct service *serv;
+
+	serv = g_hash_table_lookup(host->services, path);
+
+	if(serv)
+		type = serv->type;
+	else
+		type = connection_type_from_properties(properties);
+
+	if(type != CONNECTION_TYPE_UNKNOWN) {
+		if(!serv) {
+			add_service(host, path, properties);
+			return;
+		}
+		service_update(serv, properties);
+		clear_stale(host, path);
+	}
+}
+
+/* The technology is looked up again, the one set at creation may be gone */
+static void remove_service_struct(struct host *host, struct service *serv)
+{
+	enum connection_type type;
+
+	type = serv->type;
+	if(type != CONNECTION_TYPE_UNKNOWN && host->technologies[type])
+		technology_remove_service(host->technologies[type],
+					  serv->path);
+
+	service_free(serv);
+}
+
+void remove_service(struct host *host, const gchar *path)
+{
+	struct service *serv = g_hash_table_lookup(host->services, path);
+
+	if(!serv)
+		return;
+	PROBE_SERVICE_REMOVED(path);
+	g_hash_table_remove(host->services, path);
+	remove_service_struct(host, serv);
+}
+
+/* ServicesChanged arrives split to a record per service */
+static void services_changed(struct host *host,
+			     const struct router_delta *delta)
+{
+	gint64 start;
+
+	if(strstr(delta->object, "service/vpn"))
+		return;
+
+	start = stats_begin();
+	if(delta->kind == ROUTER_DELTA_CHANGED) {
+		struct service *serv;
+
+		serv = g_hash_table_lookup(host->services, delta->object);
+		if(serv && serv->type != CONNECTION_TYPE_UNKNOWN) {
+			service_update_fields(serv, delta->properties,
+					      delta->n_properties);
+			clear_stale(host, delta->object);
+		} else
+			modify_service(host, delta->object, delta->value);
+	} else if(delta->kind == ROUTER_DELTA_REMOVED)
+		remove_service(host, delta->object);
+	stats_end(STATS_SERVICES_CHANGED, start);
+}
+
+/* A ServicesChanged record newer than the GetServices reply held back */
+struct pending_change {
+	enum router_delta_kind kind;
+	gchar *object;
+	GVariant *value;
+};
+
+static void hold_services_changed(struct host *host,
+				  const struct router_delta *delta)
+{
+	struct pending_change *change;
+
+	if(strstr(delta->object, "service/vpn"))
+		return;
+
+	change = g_malloc(sizeof(*change));
+	change->kind = delta->kind;
+	change->object = g_strdup(delta->object);
+	change->value = delta->value ? g_variant_ref(delta->value) : NULL;
+	g_queue_push_tail(&host->pending_changes, change);
+}
+
+static void pending_change_free(struct pending_change *change)
+{
+	g_free(change->object);
+	if(change->value)
+		g_variant_unref(change->value);
+	g_free(change);
+}
+
+static void drop_pending_changes(struct host *host)
+{
+	struct pending_change *change;
+
+	while((change = g_queue_pop_head(&host->pending_changes)))
+		pending_change_free(change);
+}
+
+static void manager_signal(const struct router_delta *delta,
+			   gpointer user_data)
+{
+	struct host *host = user_data;
+	if(!strcmp(delta->signal, "TechnologyAdded")) {
+		add_technology(host, delta->object, delta->value, FALSE);
+	} else if(!strcmp(delta->signal, "TechnologyRemoved")) {
+		remove_technology_by_path(host, delta->object);
+	} else if(!strcmp(delta->signal, "ServicesChanged")) {
+		/* anything older than the GetServices reply is superseded */
+		if(host->services_loaded)
+			services_changed(host, delta);
+		else if(host->pending_services)
+			hold_services_changed(host, delta);
+	}
+
+	if(delta->last)
+		host_status_update(host);
+}
+
+static void add_all_technologies(struct host *host, GVariant *technologies_v,
+				 gboolean stale)
+{
+	int i;
+	int size = g_variant_n_children(technologies_v);
+
+	profile_begin("add_all_technologies");
+	for(i = 0; i < size; i++) {
+		GVariant *child, *properties;
+		const gchar *path;
+
+		child = g_variant_get_child_value(technologies_v, i);
+		g_variant_get(child, "(&o@a{sv})", &path, &properties);
+		add_technology(host, path, properties, stale);
+		g_variant_unref(properties);
+		g_variant_unref(child);
+	}
+	profile_end("add_all_technologies");
+
+	window_technologies_added(host);
+}
+
+static void add_all_services(struct host *host, GVariant *services_v)
+{
+	int i;
+	int size = g_variant_n_children(services_v);
+
+	profile_begin("add_all_services");
+	for(i = 0; i < size; i++) {
+		GVariant *path_v, *properties, *child;;
+		const gchar *path;
+
+		child = g_variant_get_child_value(services_v, i);
+		path_v = g_variant_get_child_value(child, 0);
+		properties = g_variant_get_child_value(child, 1);
+		path = g_variant_get_string(path_v, NULL);
+		if(!strstr(path, "service/vpn"))
+			modify_service(host, path, properties);
+
+		g_variant_unref(child);
+		g_variant_unref(path_v);
+		g_variant_unref(properties);
+	}
+	profile_end("add_all_services");
+}
+
+static gboolean is_stale_technology(gpointer key, gpointer value,
+				    gpointer user_data)
+{
+	struct host *host = user_data;
+
+	if(!g_hash_table_contains(host->technology_types, key))
+		return FALSE;
+	remove_technology_by_path(host, key);
+	return TRUE;
+}
+
+static gboolean is_stale_service(gpointer key, gpointer value,
+				 gpointer user_data)
+{
+	struct host *host = user_data;
+
+	if(!g_hash_table_contains(host->services, key))
+		return FALSE;
+	remove_service(host, key);
+	return TRUE;
+}
+
+/* Only the local daemon has a snapshot */
+static void load_snapshot(struct host *host)
+{
+	GVariant *technologies_v, *services_v;
+
+	if(host->address)
+		return;
+
+	profile_begin("snapshot_load");
+	if(snapshot_load(&technologies_v, &services_v)) {
+		add_all_technologies(host, technologies_v, TRUE);
+		add_all_services(host, services_v);
+		g_hash_table_foreach(host->services, mark_stale, host);
+		g_variant_unref(technologies_v);
+		g_variant_unref(services_v);
+		host_status_update(host);
+	}
+	profile_end("snapshot_load");
+}
+
+void host_save_snapshot(struct host *host)
+{
+	GVariantBuilder technologies_b, services_b;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	/* only write what the local ConnMan has told us */
+	if(host->address || !host->technologies_loaded ||
+	   !host->services_loaded || host->pending_services)
+		return;
+
+	g_variant_builder_init(&technologies_b, G_VARIANT_TYPE("a(oa{sv})"));
+	g_hash_table_iter_init(&iter, host->technology_types);
+	while(g_hash_table_iter_next(&iter, &key, &value)) {
+		enum connection_type *type = value;
+		struct technology *tech = host->technologies[*type];
+		GVariantBuilder properties;
+		GHashTableIter piter;
+		gpointer name, property;
+
+		g_variant_builder_init(&properties, G_VARIANT_TYPE("a{sv}"));
+		g_hash_table_iter_init(&piter, tech->properties);
+		while(g_hash_table_iter_next(&piter, &name, &property))
+			g_variant_builder_add(&properties, "{sv}", name,
+					      property);
+		g_variant_builder_add(&technologies_b, "(o@a{sv})", key,
+				      g_variant_builder_end(&properties));
+	}
+
+	g_variant_builder_init(&services_b, G_VARIANT_TYPE("a(oa{sv})"));
+	g_hash_table_iter_init(&iter, host->services);
+	while(g_hash_table_iter_next(&iter, &key, &value)) {
+		struct service *serv = value;
+
+		if(strstr(key, "/vpn"))
+			continue;
+		g_variant_builder_add(&services_b, "(o@a{sv})", key,
+				      dual_hash_table_to_variant(
+					      serv->properties));
+	}
+
+	snapshot_save(g_variant_builder_end(&technologies_b),
+		      g_variant_builder_end(&services_b));
+}
+
+/* Drop whatever the snapshot had but ConnMan no longer reports */
+static void services_populated(struct host *host)
+{
+	guint dropped;
+
+	dropped = g_hash_table_foreach_remove(host->stale_paths,
+					      is_stale_service, host);
+	if(host->resync_id) {
+		g_source_remove(host->resync_id);
+		host->resync_id = 0;
+		g_debug("%s resynchronised in %" G_GINT64_FORMAT " ms, %u "
+			"services dropped", host->label,
+			(g_get_monotonic_time() - host->lost_time) / 1000,
+			dropped);
+	}
+	host_status_update(host);
+	host_save_snapshot(host);
+}
+
+/* The reply first, then what changed since it was sent, in order */
+static void apply_pending_services(struct host *host)
+{
+	struct pending_change *change;
+
+	add_all_services(host, host->pending_services);
+	g_variant_unref(host->pending_services);
+	host->pending_services = NULL;
+	host->services_loaded = TRUE;
+
+	while((change = g_queue_pop_head(&host->pending_changes))) {
+		if(change->kind == ROUTER_DELTA_CHANGED)
+			modify_service(host, change->object, change->value);
+		else if(change->kind == ROUTER_DELTA_REMOVED)
+			remove_service(host, change->object);
+		pending_change_free(change);
+	}
+	services_populated(host);
+}
+
+static void get_services_cb(GVariant *data, const GError *error,
+			    gpointer user_data)
+{
+	struct host *host = user_data;
+
+	profile_end("GetServices");
+	startup_call_done();
+	if(error) {
+		if(!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_critical("Failed to get services from %s: %s",
+				   host->label, error->message);
+		return;
+	}
+
+	host->pending_services = g_variant_get_child_value(data, 0);
+	if(host->technologies_loaded)
+		apply_pending_services(host);
+}
+
+static void get_technologies_cb(GVariant *data, const GError *error,
+				gpointer user_data)
+{
+	struct host *host = user_data;
+	GVariant *child;
+
+	profile_end("GetTechnologies");
+	startup_call_done();
+	if(error) {
+		if(!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_critical("Failed to connect to connman on %s: %s",
+				   host->label, error->message);
+			show_error(_("Failed to connect to ConnMan."),
+				   error->message);
+		}
+		return;
+	}
+
+	child = g_variant_get_child_value(data, 0);
+	add_all_technologies(host, child, FALSE);
+	g_hash_table_foreach_remove(host->stale_paths, is_stale_technology,
+				    host);
+	host->technologies_loaded = TRUE;
+	g_variant_unref(child);
+
+	if(host->pending_services)
+		apply_pending_services(host);
+	host_status_update(host);
+}
+
+static void manager_call(struct host *host, const gchar *method,
+			 router_reply_cb callback)
+{
+	startup_call_begin();
+	profile_begin(method);
+	router_call(host->router, CONNMAN_PATH, "/", MANAGER_NAME, method,
+		    NULL, host->connman_cancellable, callback, host);
+}
+
+/*
+ * Issue all startup calls at once, each reply fills in its part of the
+ * window as it arrives. They go through the router, so the signals sent
+ * after a reply are only handled once it has been applied.
+ */
+static void manager_register(struct host *host)
+{
+	router_add(host->router, CONNMAN_PATH, "/", manager_signal, host);
+	manager_call(host, "GetTechnologies", get_technologies_cb);
+	manager_call(host, "GetServices", get_services_cb);
+}
+
+static void connman_appeared(GDBusConnection *connection, const gchar *name,
+                             const gchar *name_owner, gpointer user_data)
+{
+	struct host *host = user_data;
+
+	host->connman_cancellable = g_cancellable_new();
+	manager_register(host);
+	register_agent(&host->agent, connection, host->connman_cancellable);
+}
+
+static gboolean remove_if_service(gpointer key, gpointer value,
+				  gpointer user_data)
+{
+	if(!key || strstr(key, "/vpn"))
+		return FALSE;
+	remove_service_struct(user_data, value);
+	return TRUE;
+}
+
+/* The daemon did not come back, drop everything it had */
+static gboolean resync_expired(gpointer user_data)
+{
+	struct host *host = user_data;
+	int i;
+
+	host->resync_id = 0;
+	g_hash_table_remove_all(host->stale_paths);
+	g_hash_table_foreach_remove(host->services, remove_if_service, host);
+	for(i = CONNECTION_TYPE_ETHERNET; i < CONNECTION_TYPE_COUNT; i++) {
+		struct technology *tech = host->technologies[i];
+
+		if(i == CONNECTION_TYPE_VPN)
+			continue;
+
+		if(tech && tech->path)
+			remove_technology_by_path(host, tech->path);
+
+		host->technologies[i] = NULL;
+	}
+
+	if(host == current_host)
+		g_clear_pointer(&default_page, g_free);
+	host_status_update(host);
+	return G_SOURCE_REMOVE;
+}
+
+static void mark_stale_service(gpointer key, gpointer value,
+			       gpointer user_data)
+{
+	if(!strstr(key, "/vpn"))
+		mark_stale(key, value, user_data);
+}
+
+/*
+ * Keep the model through a restart. Everything is shown stale until the
+ * fresh GetTechnologies and GetServices replies confirm it, which clears
+ * the mark, or leave it out, which removes it. Only what actually changed
+ * is created or destroyed.
+ */
+static void connman_disappeared(GDBusConnection *connection, const gchar *name,
+                                gpointer user_data)
+{
+	struct host *host = user_data;
+
+	g_hash_table_foreach(host->technology_types, mark_stale, host);
+	g_hash_table_foreach(host->services, mark_stale_service, host);
+	if(host->resync_id)
+		g_source_remove(host->resync_id);
+	host->resync_id = g_timeout_add_seconds(RESYNC_GRACE, resync_expired,
+						host);
+	host->lost_time = g_get_monotonic_time();
+
+	if(host->connman_cancellable) {
+		g_cancellable_cancel(host->connman_cancellable);
+		g_object_unref(host->connman_cancellable);
+	}
+	host->connman_cancellable = NULL;
+	if(host->pending_services)
+		g_variant_unref(host->pending_services);
+	host->pending_services = NULL;
+	drop_pending_changes(host);
+	host->technologies_loaded = FALSE;
+	host->services_loaded = FALSE;
+
+	agent_release(&host->agent);
+	router_remove(host->router, CONNMAN_PATH, "/");
+	host_status_update(host);
+}
+
+static void connman_vpn_appeared(GDBusConnection *connection, const gchar *name,
+				 const gchar *name_owner, gpointer user_data)
+{
+	struct host *host = user_data;
+	enum connection_type type = CONNECTION_TYPE_VPN;
+	struct technology *vpn;
+
+	if(host->technologies[type])
+		return;
+	vpn = vpn_register(host);
+	host->technologies[type] = vpn;
+	window_add_technology(host, vpn);
+	host->vpn_cancellable = g_cancellable_new();
+	vpn_get_connections(host);
+	register_vpn_agent(&host->vpn_agent, connection,
+			   host->vpn_cancellable);
+}
+
+static gboolean remove_if_connection(gpointer key, gpointer value,
+				     gpointer user_data)
+{
+	if(!key || !strstr(key, "/vpn"))
+		return FALSE;
+	remove_service_struct(user_data, value);
+	return TRUE;
+}
+
+static void connman_vpn_disappeared(GDBusConnection *connection,
+				    const gchar *name, gpointer user_data)
+{
+	struct host *host = user_data;
+	enum connection_type type = CONNECTION_TYPE_VPN;
+
+	g_hash_table_foreach_remove(host->services, remove_if_connection,
+				    host);
+
+	if(host->technologies[type])
+		technology_free(host->technologies[type]);
+
+	host->technologies[type] = NULL;
+	if(host->vpn_cancellable) {
+		g_cancellable_cancel(host->vpn_cancellable);
+		g_object_unref(host->vpn_cancellable);
+	}
+	host->vpn_cancellable = NULL;
+	agent_release(&host->vpn_agent);
+	router_remove(host->router, CONNMAN_VPN_PATH, "/");
+	if(host == current_host && default_page &&
+	   !strcmp(default_page, "vpn"))
+		g_clear_pointer(&default_page, g_free);
+}
+
+static void host_connected(GObject *source, GAsyncResult *res,
+			   gpointer user_data)
+{
+	struct host *host = user_data;
+	GDBusConnection *connection;
+	GError *error = NULL;
+
+	if(host->address) {
+		connection = g_dbus_connection_new_for_address_finish(res,
+								      &error);
+	} else {
+		connection = g_bus_get_finish(res, &error);
+		profile_end("g_bus_get");
+	}
+	if(error) {
+		g_critical("Failed to connect to %s: %s", host->label,
+			   error->message);
+		show_error(_("Failed to connect to system DBus."),
+			   error->message);
+		g_error_free(error);
+		return;
+	}
+
+	host->connection = connection;
+	host->router = router_new(connection);
+	router_set_trace(host->router, host->trace);
+	router_subscribe(host->router, CONNMAN_PATH);
+	router_subscribe(host->router, CONNMAN_VPN_PATH);
+	load_snapshot(host);
+
+	host->connman_watch = g_bus_watch_name_on_connection(connection,
+	                               "net.connman",
+	                               G_BUS_NAME_WATCHER_FLAGS_NONE,
+	                               connman_appeared, connman_disappeared,
+	                               host, NULL);
+	host->vpn_watch = g_bus_watch_name_on_connection(connection,
+	                               "net.connman.vpn",
+	                               G_BUS_NAME_WATCHER_FLAGS_NONE,
+	                               connman_vpn_appeared,
+				       connman_vpn_disappeared,
+	                               host, NULL);
+}
+
+void host_connect(struct host *host)
+{
+	if(!host->address) {
+		profile_begin("g_bus_get");
+		g_bus_get(G_BUS_TYPE_SYSTEM, NULL, host_connected, host);
+		return;
+	}
+
+	g_dbus_connection_new_for_address(host->address,
+			G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+			G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+			NULL, NULL, host_connected, host);
+}
+
+/* Name a forwarded socket after its file, anything else by the address */
+static gchar *host_label(const gchar *address)
+{
+	const gchar *path;
+	gchar *dir, *label;
+
+	if(!address)
+		return g_strdup(_("This computer"));
+
+	path = strstr(address, "path=");
+	if(!path)
+		return g_strdup(address);
+
+	dir = g_strndup(path + 5, strcspn(path + 5, ","));
+	label = g_path_get_basename(dir);
+	g_free(dir);
+	return label;
+}
+
+struct host *host_new(const gchar *address)
+{
+	struct host *host = g_malloc0(sizeof(*host));
+
+	host->address = g_strdup(address);
+	host->label = host_label(address);
+	host->technology_types = g_hash_table_new_full(g_str_hash, g_str_equal,
+					(GDestroyNotify)path_unref, NULL);
+	host->services = g_hash_table_new_full(g_str_hash, g_str_equal,
+					(GDestroyNotify)path_unref, NULL);
+	host->stale_paths = g_hash_table_new_full(g_str_hash, g_str_equal,
+					(GDestroyNotify)path_unref, NULL);
+	return host;
+}
+
+static void cancel(GCancellable **cancellable)
+{
+	if(!*cancellable)
+		return;
+	g_cancellable_cancel(*cancellable);
+	g_clear_object(cancellable);
+}
+
+/*
+ * At exit, once the main loop has stopped. The technologies go first,
+ * they detach the services, and the router last, the services and
+ * technologies remove their routes from it.
+ */
+void host_free(struct host *host)
+{
+	GHashTableIter iter;
+	gpointer value;
+	int i;
+
+	if(!host)
+		return;
+
+	if(host->connman_watch)
+		g_bus_unwatch_name(host->connman_watch);
+	if(host->vpn_watch)
+		g_bus_unwatch_name(host->vpn_watch);
+	if(host->resync_id)
+		g_source_remove(host->resync_id);
+	cancel(&host->connman_cancellable);
+	cancel(&host->vpn_cancellable);
+	agent_release(&host->agent);
+	agent_release(&host->vpn_agent);
+
+	for(i = 0; i < CONNECTION_TYPE_COUNT; i++)
+		technology_free(host->technologies[i]);
+	g_hash_table_iter_init(&iter, host->services);
+	while(g_hash_table_iter_next(&iter, NULL, &value))
+		service_free(value);
+
+	g_hash_table_unref(host->technology_types);
+	g_hash_table_unref(host->services);
+	g_hash_table_unref(host->stale_paths);
+	if(host->pending_services)
+		g_variant_unref(host->pending_services);
+	drop_pending_changes(host);
+
+	router_free(host->router);
+	trace_free(host->trace);
+	if(host->connection)
+		g_object_unref(host->connection);
+	g_free(host->address);
+	g_free(host->label);
+	g_free(host);
+}
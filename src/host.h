@@ -0,0 +1,85 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_HOST_H
+#define _CONNMAN_GTK_HOST_H
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "connection.h"
+#include "router.h"
+
+struct agent;
+struct trace;
+
+/*
+ * One ConnMan daemon and the model of what it reports. Every host has its
+ * own bus connection and router, and with it its own decoding thread.
+ * Only the host shown in the window has widgets.
+ */
+struct host {
+	/* NULL for the local system bus */
+	gchar *address;
+	gchar *label;
+
+	GDBusConnection *connection;
+	struct router *router;
+	/* signals and startup replies are recorded here if set */
+	struct trace *trace;
+
+	struct technology *technologies[CONNECTION_TYPE_COUNT];
+	GHashTable *technology_types;
+	GHashTable *services;
+	/* objects only known from the snapshot so far */
+	GHashTable *stale_paths;
+
+	guint connman_watch;
+	guint vpn_watch;
+	GCancellable *connman_cancellable;
+	GCancellable *vpn_cancellable;
+	struct agent *agent;
+	struct agent *vpn_agent;
+
+	/*
+	 * GetServices may not be applied before the technologies exist.
+	 * Until it is, the ServicesChanged received after its reply are
+	 * held too, and services_loaded stays unset.
+	 */
+	gboolean technologies_loaded;
+	gboolean services_loaded;
+	GVariant *pending_services;
+	GQueue pending_changes;
+
+	/* while set, the daemon went away and the model is kept stale */
+	guint resync_id;
+	gint64 lost_time;
+};
+
+struct host *host_new(const gchar *address);
+void host_connect(struct host *host);
+void host_free(struct host *host);
+void host_apply_stale(struct host *host);
+void host_save_snapshot(struct host *host);
+void modify_service(struct host *host, const gchar *path,
+		    GVariant *properties);
+void remove_service(struct host *host, const gchar *path);
+
+#endif /* _CONNMAN_GTK_HOST_H */
@@ -0,0 +1,86 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "interfaces.h"
+
+static const struct {
+	const gchar *xml;
+	const gchar *name;
+} interface_data[INTERFACE_COUNT] = {
+	[INTERFACE_MANAGER] = { MANAGER_INTERFACE, MANAGER_NAME },
+	[INTERFACE_TECHNOLOGY] = { TECHNOLOGY_INTERFACE, TECHNOLOGY_NAME },
+	[INTERFACE_SERVICE] = { SERVICE_INTERFACE, SERVICE_NAME },
+	[INTERFACE_AGENT] = { AGENT_INTERFACE, AGENT_NAME },
+	[INTERFACE_VPN_MANAGER] = { VPN_MANAGER_INTERFACE, VPN_MANAGER_NAME },
+	[INTERFACE_VPN_AGENT] = { VPN_AGENT_INTERFACE, VPN_AGENT_NAME },
+	[INTERFACE_VPN_CONNECTION] = { VPN_CONNECTION_INTERFACE,
+				       VPN_CONNECTION_NAME },
+};
+
+static GDBusNodeInfo *nodes[INTERFACE_COUNT];
+static GDBusInterfaceInfo *interfaces[INTERFACE_COUNT];
+
+void interfaces_init(void)
+{
+	int i;
+
+	for(i = 0; i < INTERFACE_COUNT; i++) {
+		GError *error = NULL;
+
+		if(nodes[i])
+			continue;
+
+		nodes[i] = g_dbus_node_info_new_for_xml(interface_data[i].xml,
+							&error);
+		if(error) {
+			g_critical("Failed to load interface %s: %s",
+				   interface_data[i].name, error->message);
+			g_error_free(error);
+			continue;
+		}
+
+		interfaces[i] = g_dbus_node_info_lookup_interface(nodes[i],
+						interface_data[i].name);
+		/* Lookups on the info are hot, build the hash tables now */
+		g_dbus_interface_info_cache_build(interfaces[i]);
+	}
+}
+
+void interfaces_free(void)
+{
+	int i;
+
+	for(i = 0; i < INTERFACE_COUNT; i++) {
+		if(!nodes[i])
+			continue;
+		g_dbus_interface_info_cache_release(interfaces[i]);
+		g_dbus_node_info_unref(nodes[i]);
+		nodes[i] = NULL;
+		interfaces[i] = NULL;
+	}
+}
+
+GDBusInterfaceInfo *interface_info(enum interface_id id)
+{
+	return interfaces[id];
+}
@@ -21,6 +21,8 @@
 #ifndef _CONNMAN_GTK_INTERFACES_H
 #define _CONNMAN_GTK_INTERFACES_H
 
+#include <gio/gio.h>
+
 #define CONNMAN_PATH "net.connman"
 #define CONNMAN_VPN_PATH "net.connman.vpn"
 
@@ -190,4 +192,20 @@
         "</interface>" \
         "</node>"
 
+enum interface_id {
+	INTERFACE_MANAGER,
+	INTERFACE_TECHNOLOGY,
+	INTERFACE_SERVICE,
+	INTERFACE_AGENT,
+	INTERFACE_VPN_MANAGER,
+	INTERFACE_VPN_AGENT,
+	INTERFACE_VPN_CONNECTION,
+	INTERFACE_COUNT
+};
+
+/* Parse every interface above once, the results are shared by everyone */
+void interfaces_init(void);
+void interfaces_free(void);
+GDBusInterfaceInfo *interface_info(enum interface_id id);
+
 #endif /* _CONNMAN_GTK_INTERFACES_H */
@@ -19,6 +19,7 @@
  */
 
 #include <locale.h>
+#include <stdlib.h>
 
 #include <gio/gio.h>
 #include <glib.h>
@@ -30,308 +31,122 @@
 #include "connection.h"
 #include "configurator.h"
 #include "dialog.h"
+#include "frame_monitor.h"
+#include "host.h"
 #include "technology.h"
 #include "interfaces.h"
+#include "main.h"
+#include "metrics.h"
+#include "profile.h"
+#include "stats.h"
 #include "status.h"
 #include "style.h"
+#include "trace.h"
 #include "vpn.h"
 #include "util.h"
+#include "watchdog.h"
 
-GtkWidget *list, *notebook, *main_window;
-GHashTable *technology_types, *services;
-GDBusProxy *manager_proxy, *vpn_manager_proxy;
-struct technology *technologies[CONNECTION_TYPE_COUNT];
+GtkWidget *list, *notebook, *main_window, *host_combo;
 gboolean shutting_down = FALSE;
 
-const gchar *default_page;
+/* Every daemon managed, the window shows current_host */
+GPtrArray *hosts;
+struct host *current_host;
+gchar **host_addresses;
+gchar *record_trace;
 
-gboolean no_icon;
-
-/* sort smallest enum value first */
-gint technology_list_sort_cb(GtkListBoxRow *row1, GtkListBoxRow *row2,
-                             gpointer user_data)
-{
-	enum connection_type type1 = *(enum connection_type *)g_object_get_data(
-	                                     G_OBJECT(row1), "technology-type");
-	enum connection_type type2 = *(enum connection_type *)g_object_get_data(
-	                                     G_OBJECT(row2), "technology-type");
-	return type1 - type2;
-}
-
-static void create_content(void)
-{
-	GtkWidget *frame, *grid;
-#ifdef HAVE_CONFIG_SETTINGS
-	GtkWidget *settings;
-#endif
-
-	grid = gtk_grid_new();
-	style_set_margin(grid, MARGIN_LARGE);
-	gtk_widget_set_hexpand(grid, TRUE);
-	gtk_widget_set_vexpand(grid, TRUE);
-
-	frame = gtk_frame_new(NULL);
-	list = gtk_list_box_new();
-	notebook = gtk_notebook_new();
-	gtk_list_box_set_selection_mode(GTK_LIST_BOX(list),
-	                                GTK_SELECTION_BROWSE);
-	gtk_list_box_set_sort_func(GTK_LIST_BOX(list), technology_list_sort_cb,
-	                           NULL, NULL);
-	g_signal_connect(list, "row-selected", G_CALLBACK(list_item_selected),
-	                 notebook);
-	gtk_widget_set_size_request(list, LIST_WIDTH, -1);
+int startup_pending;
+gboolean startup_populated, startup_painted, startup_timed_out;
 
-	gtk_notebook_set_show_tabs(GTK_NOTEBOOK(notebook), FALSE);
-	gtk_notebook_set_show_border(GTK_NOTEBOOK(notebook), FALSE);
-	gtk_widget_set_vexpand(frame, TRUE);
-	gtk_widget_set_hexpand(notebook, TRUE);
-	gtk_widget_set_vexpand(notebook, TRUE);
+gchar *default_page;
 
-	gtk_container_add(GTK_CONTAINER(frame), list);
-	gtk_grid_attach(GTK_GRID(grid), frame, 0, 0, 1, 1);
-	gtk_grid_attach(GTK_GRID(grid), notebook, 1, 0, 1, 2);
-	gtk_container_add(GTK_CONTAINER(main_window), grid);
+gboolean no_icon;
 
-#ifdef HAVE_CONFIG_SETTINGS
-	settings = gtk_button_new_with_mnemonic(_("_Settings"));
-	g_signal_connect(settings, "clicked", G_CALLBACK(config_window_open),
-	                 NULL);
-	gtk_widget_set_margin_top(settings, MARGIN_SMALL);
-	gtk_widget_set_vexpand(settings, FALSE);
-	gtk_widget_set_valign(settings, GTK_ALIGN_END);
-	gtk_grid_attach(GTK_GRID(grid), settings, 0, 1, 1, 1);
-#endif
-}
+/* kept over the window being closed to the tray and opened again */
+static gint window_width = DEFAULT_WIDTH, window_height = DEFAULT_HEIGHT;
 
-static void tech_item_mnemonic_callback(GtkWidget *widget, gboolean arg1,
-			       gpointer user_data)
+/*
+ * With --profile-quit, exit as soon as the window is painted and filled,
+ * or only filled when starting to the tray
+ */
+static void startup_check_done(void)
 {
-	list_item_selected(NULL, GTK_LIST_BOX_ROW(widget), user_data);
+	if(profile_quit && startup_populated &&
+	   (startup_painted || !main_window))
+		g_application_quit(g_application_get_default());
 }
 
-static void add_technology(GDBusConnection *connection, GVariant *technology)
+static gboolean startup_timeout(gpointer user_data)
 {
-	GVariant *path;
-	const gchar *object_path;
-	GVariant *properties;
-	GDBusProxy *proxy;
-	GDBusNodeInfo *info;
-	GError *error = NULL;
-	struct technology *item;
-	info = g_dbus_node_info_new_for_xml(TECHNOLOGY_INTERFACE, &error);
-	if(error) {
-		g_warning("Failed to load technology interface: %s",
-		          error->message);
-		g_error_free(error);
-		return;
-	}
-
-	path = g_variant_get_child_value(technology, 0);
-	properties = g_variant_get_child_value(technology, 1);
-
-	object_path = g_variant_get_string(path, NULL);
-
-	if(g_hash_table_contains(technology_types, object_path))
-		goto out;
-
-	proxy = g_dbus_proxy_new_sync(connection, G_DBUS_PROXY_FLAGS_NONE,
-	                              g_dbus_node_info_lookup_interface(info,
-	                                              "net.connman.Technology"),
-	                              "net.connman", object_path,
-	                              "net.connman.Technology", NULL, &error);
-	if(error) {
-		g_warning("failed to connect ConnMan technology proxy: %s",
-		          error->message);
-		g_error_free(error);
-		goto out;
-	}
-
-	item = technology_create(proxy, object_path, properties);
-	g_signal_connect(item->list_item->item, "mnemonic-activate",
-			 G_CALLBACK(tech_item_mnemonic_callback), notebook);
-
-	g_hash_table_insert(technology_types, g_strdup(object_path),
-	                    &item->type);
-	technologies[item->type] = item;
-
-	gtk_container_add(GTK_CONTAINER(list), item->list_item->item);
-	gtk_notebook_append_page(GTK_NOTEBOOK(notebook),
-	                         item->settings->grid, NULL);
-
-out:
-	g_dbus_node_info_unref(info);
-	g_variant_unref(path);
-	g_variant_unref(properties);
-}
-
-static void remove_technology_by_path(const gchar *path)
-{
-	enum connection_type *type_p;
-	enum connection_type type;
-
-	type_p = g_hash_table_lookup(technology_types, path);
-
-	if(!type_p)
-		return;
-	type = *type_p;
-	g_hash_table_remove(technology_types, path);
-	technology_free(technologies[type]);
-	technologies[type] = NULL;
+	g_warning("Startup did not finish, quitting");
+	startup_timed_out = TRUE;
+	g_application_quit(g_application_get_default());
+	return G_SOURCE_REMOVE;
 }
 
-static void remove_technology(GVariant *parameters)
+void startup_call_begin(void)
 {
-	GVariant *path_v;
-	const gchar *path;
-
-	path_v = g_variant_get_child_value(parameters, 0);
-	path = g_variant_get_string(path_v, NULL);
-	remove_technology_by_path(path);
-	g_variant_unref(path_v);
+	startup_pending++;
 }
 
-static void add_service(GDBusConnection *connection, const gchar *path,
-                        GVariant *properties)
+void startup_call_done(void)
 {
-	struct service *serv;
-	GDBusProxy *proxy;
-	GDBusNodeInfo *info;
-	GDBusInterfaceInfo *interface;
-	GError *error = NULL;
-	enum connection_type type;
-	const char *interface_xml;
-	const char *connman_name;
-	const char *interface_name;
-
-	type = connection_type_from_properties(properties);
-	if(type == CONNECTION_TYPE_VPN) {
-		interface_xml = VPN_CONNECTION_INTERFACE;
-		connman_name = CONNMAN_VPN_PATH;
-		interface_name = VPN_CONNECTION_NAME;
-	}
-	else {
-		interface_xml = SERVICE_INTERFACE;
-		connman_name = CONNMAN_PATH;
-		interface_name = SERVICE_NAME;
-	}
-	info = g_dbus_node_info_new_for_xml(interface_xml, &error);
-	if(error) {
-		g_warning("Failed to load service interface: %s",
-			  error->message);
-		g_error_free(error);
+	startup_pending--;
+	if(startup_pending || startup_populated)
 		return;
-	}
-
-	interface = g_dbus_node_info_lookup_interface(info, interface_name);
-	proxy = g_dbus_proxy_new_sync(connection, G_DBUS_PROXY_FLAGS_NONE,
-				      interface, connman_name, path,
-	                              interface_name, NULL, &error);
-	if(error) {
-		g_warning("failed to connect ConnMan service proxy: %s",
-		          error->message);
-		g_error_free(error);
-		goto out;
-	}
-
-	serv = service_create(technologies[type], proxy, path, properties);
-	g_hash_table_insert(services, g_strdup(path), serv);
-	if(technologies[type])
-		technology_add_service(technologies[type], serv);
-
-out:
-	g_dbus_node_info_unref(info);
-}
 
-void modify_service(GDBusConnection *connection, const gchar *path,
-                           GVariant *properties)
-{
-	enum connection_type type;
-	struct service *serv;
-
-	serv = g_hash_table_lookup(services, path);
-
-	if(serv)
-		type = serv->type;
-	else
-		type = connection_type_from_properties(properties);
-
-	if(type != CONNECTION_TYPE_UNKNOWN) {
-		if(!serv) {
-			add_service(connection, path, properties);
-			return;
-		}
-		service_update(serv, properties);
-	}
+	startup_populated = TRUE;
+	profile_mark("populated");
+	startup_check_done();
 }
 
-static void remove_service_struct(struct service *serv)
+static gboolean first_frame(GtkWidget *widget, cairo_t *cr,
+			    gpointer user_data)
 {
-	enum connection_type type;
-
-	type = serv->type;
-	if(type != CONNECTION_TYPE_UNKNOWN && technologies[type])
-		technology_remove_service(technologies[type], serv->path);
-
-	service_free(serv);
+	g_signal_handlers_disconnect_by_func(widget, first_frame, user_data);
+	startup_painted = TRUE;
+	profile_mark("first_frame");
+	startup_check_done();
+	return FALSE;
 }
 
-void remove_service(const gchar *path)
+/* sort smallest enum value first */
+gint technology_list_sort_cb(GtkListBoxRow *row1, GtkListBoxRow *row2,
+                             gpointer user_data)
 {
-	g_hash_table_remove(services, path);
+	enum connection_type type1 = *(enum connection_type *)g_object_get_data(
+	                                     G_OBJECT(row1), "technology-type");
+	enum connection_type type2 = *(enum connection_type *)g_object_get_data(
+	                                     G_OBJECT(row2), "technology-type");
+	return type1 - type2;
 }
 
-static void services_changed(GDBusConnection *connection, GVariant *parameters)
+static void tech_item_mnemonic_callback(GtkWidget *widget, gboolean arg1,
+			       gpointer user_data)
 {
-	GVariant *modified, *deleted;
-	GVariantIter *iter;
-	gchar *path;
-	GVariant *value;
-
-	modified = g_variant_get_child_value(parameters, 0);
-	deleted = g_variant_get_child_value(parameters, 1);
-
-	iter = g_variant_iter_new(modified);
-	while(g_variant_iter_loop(iter, "(o@*)", &path, &value))
-		if(!strstr(path, "service/vpn"))
-			modify_service(connection, path, value);
-	g_variant_iter_free(iter);
-
-	iter = g_variant_iter_new(deleted);
-	while(g_variant_iter_loop(iter, "o", &path))
-		if(!strstr(path, "service/vpn"))
-			remove_service(path);
-	g_variant_iter_free(iter);
-
-	g_variant_unref(modified);
-	g_variant_unref(deleted);
+	list_item_selected(NULL, GTK_LIST_BOX_ROW(widget), user_data);
 }
 
-static void manager_signal(GDBusProxy *proxy, gchar *sender, gchar *signal,
-                           GVariant *parameters, gpointer user_data)
+/* Technology attached to the main window */
+static void technology_attach(struct technology *tech)
 {
-	GDBusConnection *connection = g_dbus_proxy_get_connection(proxy);
-	if(!strcmp(signal, "TechnologyAdded")) {
-		add_technology(connection, parameters);
-	} else if(!strcmp(signal, "TechnologyRemoved")) {
-		remove_technology(parameters);
-	} else if(!strcmp(signal, "ServicesChanged")) {
-		services_changed(connection, parameters);
-	}
+	technology_ui_create(tech);
+	g_signal_connect(tech->list_item->item, "mnemonic-activate",
+			 G_CALLBACK(tech_item_mnemonic_callback), notebook);
 
-	status_update();
+	gtk_container_add(GTK_CONTAINER(list), tech->list_item->item);
+	gtk_notebook_append_page(GTK_NOTEBOOK(notebook),
+	                         tech->settings->grid, NULL);
 }
 
-static void add_all_technologies(GDBusConnection *connection,
-                                 GVariant *technologies_v)
+static void select_default_page(void)
 {
+	struct technology **technologies = current_host->technologies;
 	int i;
-	int size = g_variant_n_children(technologies_v);
 	enum connection_type default_type = CONNECTION_TYPE_UNKNOWN;
-	for(i = 0; i < size; i++) {
-		GVariant *child = g_variant_get_child_value(technologies_v, i);
-		add_technology(connection, child);
-		g_variant_unref(child);
-	}
+
+	if(!main_window)
+		return;
 
 	if(default_page)
 		default_type = connection_type_from_string(default_page);
@@ -351,11 +166,15 @@ static void add_all_technologies(GDBusConnection *connection,
 			gtk_list_box_select_row(GTK_LIST_BOX(list),
 						GTK_LIST_BOX_ROW(row));
 
-			default_page = NULL;
+			g_clear_pointer(&default_page, g_free);
 			return;
 		}
 	}
 
+	/* Keep the page picked while the snapshot was shown */
+	if(gtk_list_box_get_selected_row(GTK_LIST_BOX(list)))
+		return;
+
 	/* Default page wasn't set or wasn't found, select any possible page */
 	for(i = CONNECTION_TYPE_ETHERNET; i < CONNECTION_TYPE_COUNT; i++) {
 		if(technologies[i]) {
@@ -367,275 +186,329 @@ static void add_all_technologies(GDBusConnection *connection,
 	}
 }
 
-static void add_all_services(GDBusConnection *connection, GVariant *services_v)
+/* Technology added to a host, shown if the host is in the window */
+void window_add_technology(struct host *host, struct technology *tech)
 {
-	int i;
-	int size = g_variant_n_children(services_v);
-	for(i = 0; i < size; i++) {
-		GVariant *path_v, *properties, *child;;
-		const gchar *path;
-
-		child = g_variant_get_child_value(services_v, i);
-		path_v = g_variant_get_child_value(child, 0);
-		properties = g_variant_get_child_value(child, 1);
-		path = g_variant_get_string(path_v, NULL);
-		if(!strstr(path, "service/vpn"))
-			add_service(connection, path, properties);
-
-		g_variant_unref(child);
-		g_variant_unref(path_v);
-		g_variant_unref(properties);
-	}
+	GtkWidget *row;
+
+	if(!main_window || host != current_host)
+		return;
+
+	technology_attach(tech);
+	if(tech->type != CONNECTION_TYPE_VPN || !default_page ||
+	   strcmp(default_page, "vpn"))
+		return;
+
+	row = tech->list_item->item;
+	gtk_list_box_select_row(GTK_LIST_BOX(list), GTK_LIST_BOX_ROW(row));
+	g_clear_pointer(&default_page, g_free);
 }
 
-static GDBusProxy *manager_create(GDBusConnection *connection,
-				  const gchar *interface_data,
-				  const gchar *path, const gchar *connman_path)
+void window_technologies_added(struct host *host)
 {
-	GDBusNodeInfo *info;
-	GDBusInterfaceInfo *interface;
-	GError *error = NULL;
-	GDBusProxy *proxy;
-
-	info = g_dbus_node_info_new_for_xml(interface_data, &error);
-	if(error)
-		goto out;
-
-	interface = g_dbus_node_info_lookup_interface(info, path);
-	proxy = g_dbus_proxy_new_sync(connection, G_DBUS_PROXY_FLAGS_NONE,
-				      interface, connman_path, "/", path, NULL,
-				      &error);
-	g_dbus_node_info_unref(info);
-	if(error)
-		goto out;
-
-	return proxy;
-
-out:
-	g_critical("Failed to connect to connman: %s", error->message);
-	show_error(_("Failed to connect to ConnMan."), error->message);
-	g_error_free(error);
-	return NULL;
+	if(host == current_host)
+		select_default_page();
 }
 
-static GDBusProxy *manager_register(GDBusConnection *connection)
+static void host_attach(struct host *host)
 {
-	GError *error = NULL;
-	GDBusProxy *proxy;
-	GVariant *data, *child;
-
-	proxy = manager_create(connection, MANAGER_INTERFACE, MANAGER_NAME,
-			       CONNMAN_PATH);
-	if(!proxy)
-		return NULL;
-
-	data = g_dbus_proxy_call_sync(proxy, "GetTechnologies", NULL,
-	                              G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
-	if(error) {
-		g_object_unref(proxy);
-		goto out;
-	}
-
-	g_signal_connect(proxy, "g-signal", G_CALLBACK(manager_signal), NULL);
-
-	child = g_variant_get_child_value(data, 0);
-	add_all_technologies(connection, child);
-
-	g_variant_unref(data);
-	g_variant_unref(child);
-
-	data = g_dbus_proxy_call_sync(proxy, "GetServices", NULL,
-	                              G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
-	if(error) {
-		g_object_unref(proxy);
-		goto out;
-	}
-
-	child = g_variant_get_child_value(data, 0);
-	add_all_services(connection, child);
+	int i;
 
-	g_variant_unref(data);
-	g_variant_unref(child);
+	for(i = CONNECTION_TYPE_ETHERNET; i < CONNECTION_TYPE_COUNT; i++)
+		if(host->technologies[i])
+			technology_attach(host->technologies[i]);
+	host_apply_stale(host);
+}
 
-	return proxy;
+static void host_detach(struct host *host)
+{
+	int i;
 
-out:
-	g_critical("Failed to connect to connman: %s", error->message);
-	g_error_free(error);
-	return NULL;
+	for(i = CONNECTION_TYPE_ETHERNET; i < CONNECTION_TYPE_COUNT; i++)
+		if(host->technologies[i])
+			technology_ui_free(host->technologies[i]);
 }
 
-static GDBusProxy *vpn_manager_register(GDBusConnection *connection)
+/* Only the shown host has widgets, the others keep just their model */
+static void host_changed(GtkComboBox *combo, gpointer user_data)
 {
-	GDBusProxy *proxy;
+	gint index = gtk_combo_box_get_active(combo);
+	struct host *host;
 
-	proxy = manager_create(connection, VPN_MANAGER_INTERFACE,
-			       VPN_MANAGER_NAME, CONNMAN_VPN_PATH);
-	if(!proxy)
-		return NULL;
+	if(index < 0)
+		return;
+	host = g_ptr_array_index(hosts, index);
+	if(host == current_host)
+		return;
 
-	vpn_get_connections(proxy);
-	return proxy;
+	host_detach(current_host);
+	current_host = host;
+	host_attach(host);
+	select_default_page();
+	status_update();
 }
 
-static void connman_appeared(GDBusConnection *connection, const gchar *name,
-                             const gchar *name_owner, gpointer user_data)
+static GtkWidget *create_host_combo(void)
 {
-	manager_proxy = manager_register(connection);
-	register_agent(connection, manager_proxy);
+	GtkWidget *combo = gtk_combo_box_text_new();
+	guint i;
 
-	status_update();
+	for(i = 0; i < hosts->len; i++) {
+		struct host *host = g_ptr_array_index(hosts, i);
+
+		gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo),
+					       host->label);
+		if(host == current_host)
+			gtk_combo_box_set_active(GTK_COMBO_BOX(combo),
+						 (gint)i);
+	}
+	g_signal_connect(combo, "changed", G_CALLBACK(host_changed), NULL);
+	gtk_widget_set_margin_bottom(combo, MARGIN_SMALL);
+	return combo;
 }
 
-static gboolean is_service(gpointer key, gpointer value, gpointer user_data)
+/* Without --host only the local system bus is managed */
+static void hosts_init(void)
 {
-	return key && !strstr(key, "/vpn");
+	gchar **address;
+
+	hosts = g_ptr_array_new();
+	if(!host_addresses || !*host_addresses) {
+		g_ptr_array_add(hosts, host_new(NULL));
+	} else {
+		for(address = host_addresses; *address; address++) {
+			const gchar *bus = *address;
+
+			if(!strcmp(bus, "system"))
+				bus = NULL;
+			g_ptr_array_add(hosts, host_new(bus));
+		}
+	}
+	current_host = g_ptr_array_index(hosts, 0);
+	/* only the first host, the traces of several would interleave */
+	if(record_trace)
+		current_host->trace = trace_new(record_trace);
+	g_ptr_array_foreach(hosts, (GFunc)host_connect, NULL);
 }
 
-static void connman_disappeared(GDBusConnection *connection, const gchar *name,
-                                gpointer user_data)
+static void app_shutdown(GtkApplication *app, gpointer user_data)
 {
-	int i;
-	g_hash_table_foreach_remove(services, is_service, NULL);
-	for(i = CONNECTION_TYPE_ETHERNET; i < CONNECTION_TYPE_COUNT; i++) {
-		if(i == CONNECTION_TYPE_VPN)
-			continue;
+	guint i;
 
-		if(technologies[i] && technologies[i]->path)
-			remove_technology_by_path(technologies[i]->path);
+	shutting_down = TRUE;
+	for(i = 0; i < hosts->len; i++) {
+		struct host *host = g_ptr_array_index(hosts, i);
 
-		technologies[i] = NULL;
+		agent_release(&host->agent);
+		trace_close(host->trace);
 	}
-
-	agent_release();
-	if(manager_proxy)
-		g_object_unref(manager_proxy);
-	manager_proxy = NULL;
-	default_page = NULL;
+	metrics_stop();
+	watchdog_stop();
 }
 
-static void connman_vpn_appeared(GDBusConnection *connection, const gchar *name,
-				 const gchar *name_owner, gpointer user_data)
+/* The model outlives the window, only drop the widgets showing it */
+static void window_destroyed(GtkWidget *window, gpointer user_data)
 {
-	enum connection_type type = CONNECTION_TYPE_VPN;
-	if(technologies[type])
-		return;
-	struct technology *vpn = vpn_register(connection, list, notebook);
-	technologies[type] = vpn;
-	gtk_container_add(GTK_CONTAINER(list), vpn->list_item->item);
-	gtk_notebook_append_page(GTK_NOTEBOOK(notebook),
-	                         vpn->settings->grid, NULL);
-	vpn_manager_proxy = vpn_manager_register(connection);
-	register_vpn_agent(connection, vpn_manager_proxy);
-	if(default_page && !strcmp(default_page, "vpn")) {
-		GtkWidget *row = technologies[type]->list_item->item;
-		gtk_list_box_select_row(GTK_LIST_BOX(list),
-					GTK_LIST_BOX_ROW(row));
-		default_page = NULL;
-	}
-}
+	gtk_window_get_size(GTK_WINDOW(window), &window_width, &window_height);
+	host_detach(current_host);
 
-static gboolean is_connection(gpointer key, gpointer value, gpointer user_data)
-{
-	return key && strstr(key, "/vpn");
+	main_window = NULL;
+	list = NULL;
+	notebook = NULL;
+	host_combo = NULL;
 }
 
-static void connman_vpn_disappeared(GDBusConnection *connection,
-				    const gchar *name, gpointer user_data)
+static void create_content(void)
 {
-	enum connection_type type = CONNECTION_TYPE_VPN;
+	GtkWidget *frame, *grid;
+#ifdef HAVE_CONFIG_SETTINGS
+	GtkWidget *settings;
+#endif
 
-	g_hash_table_foreach_remove(services, is_connection, NULL);
+	profile_begin("create_content");
+	grid = gtk_grid_new();
+	style_set_margin(grid, MARGIN_LARGE);
+	gtk_widget_set_hexpand(grid, TRUE);
+	gtk_widget_set_vexpand(grid, TRUE);
 
-	if(technologies[type])
-		technology_free(technologies[type]);
+	frame = gtk_frame_new(NULL);
+	list = gtk_list_box_new();
+	notebook = gtk_notebook_new();
+	gtk_list_box_set_selection_mode(GTK_LIST_BOX(list),
+	                                GTK_SELECTION_BROWSE);
+	gtk_list_box_set_sort_func(GTK_LIST_BOX(list), technology_list_sort_cb,
+	                           NULL, NULL);
+	g_signal_connect(list, "row-selected", G_CALLBACK(list_item_selected),
+	                 notebook);
+	gtk_widget_set_size_request(list, LIST_WIDTH, -1);
 
-	technologies[type] = NULL;
-	vpn_agent_release();
-	if(vpn_manager_proxy)
-		g_object_unref(vpn_manager_proxy);
-	vpn_manager_proxy = NULL;
-	if(default_page && !strcmp(default_page, "vpn"))
-		default_page = NULL;
+	gtk_notebook_set_show_tabs(GTK_NOTEBOOK(notebook), FALSE);
+	gtk_notebook_set_show_border(GTK_NOTEBOOK(notebook), FALSE);
+	gtk_widget_set_vexpand(frame, TRUE);
+	gtk_widget_set_hexpand(notebook, TRUE);
+	gtk_widget_set_vexpand(notebook, TRUE);
+
+	gtk_container_add(GTK_CONTAINER(frame), list);
+	gtk_grid_attach(GTK_GRID(grid), frame, 0, 0, 1, 1);
+	gtk_grid_attach(GTK_GRID(grid), notebook, 1, 0, 1, 2);
+	gtk_container_add(GTK_CONTAINER(main_window), grid);
+
+	if(hosts->len > 1) {
+		host_combo = create_host_combo();
+		gtk_grid_attach(GTK_GRID(grid), host_combo, 0, -1, 1, 1);
+	}
+
+#ifdef HAVE_CONFIG_SETTINGS
+	settings = gtk_button_new_with_mnemonic(_("_Settings"));
+	g_signal_connect(settings, "clicked", G_CALLBACK(config_window_open),
+	                 NULL);
+	gtk_widget_set_margin_top(settings, MARGIN_SMALL);
+	gtk_widget_set_vexpand(settings, FALSE);
+	gtk_widget_set_valign(settings, GTK_ALIGN_END);
+	gtk_grid_attach(GTK_GRID(grid), settings, 0, 1, 1, 1);
+#endif
+	profile_end("create_content");
 }
 
-static void dbus_connected(GObject *source, GAsyncResult *res,
-                           gpointer user_data)
+static void window_create(GtkApplication *app)
 {
-	(void)source;
-	(void)user_data;
-	GDBusConnection *connection;
-	GError *error = NULL;
-
-	connection = g_bus_get_finish(res, &error);
-	if(error) {
-		g_error("failed to connect to system dbus: %s",
-		        error->message);
-		show_error(_("Failed to connect to system DBus."),
-			   error->message);
-		g_error_free(error);
-		return;
+	struct technology *vpn;
+
+	profile_begin("window_create");
+	main_window = gtk_application_window_new(app);
+	gtk_window_set_title(GTK_WINDOW(main_window), _("Network Settings"));
+	gtk_window_set_default_size(GTK_WINDOW(main_window), window_width,
+	                            window_height);
+
+	create_content();
+
+	g_signal_connect(G_OBJECT(main_window), "key_press_event", G_CALLBACK(handle_keyboard_shortcut), NULL);
+	g_signal_connect(main_window, "destroy", G_CALLBACK(window_destroyed),
+			 NULL);
+	frame_monitor_attach(main_window, "main");
+	if(!startup_painted)
+		g_signal_connect_after(main_window, "draw",
+				       G_CALLBACK(first_frame), NULL);
+	gtk_widget_show_all(main_window);
+
+	host_attach(current_host);
+
+	vpn = current_host->technologies[CONNECTION_TYPE_VPN];
+	if(default_page && !strcmp(default_page, "vpn") && vpn) {
+		GtkWidget *row;
+
+		row = vpn->list_item->item;
+		gtk_list_box_select_row(GTK_LIST_BOX(list),
+					GTK_LIST_BOX_ROW(row));
+		g_clear_pointer(&default_page, g_free);
 	}
+	select_default_page();
+
+	/*
+	 * Closing the window destroys it even with the status icon, the
+	 * application is held and only the model stays in memory until the
+	 * window is opened again
+	 */
+	profile_end("window_create");
+}
 
-	g_bus_watch_name_on_connection(connection, "net.connman",
-	                               G_BUS_NAME_WATCHER_FLAGS_NONE,
-	                               connman_appeared, connman_disappeared,
-	                               NULL, NULL);
-	g_bus_watch_name_on_connection(connection, "net.connman.vpn",
-	                               G_BUS_NAME_WATCHER_FLAGS_NONE,
-	                               connman_vpn_appeared,
-				       connman_vpn_disappeared,
-	                               NULL, NULL);
+static void show_statistics(GSimpleAction *action, GVariant *parameter,
+			    gpointer user_data)
+{
+	stats_window_show();
 }
 
-static gboolean delete_event(GtkApplication *app, GdkEvent *event,
-                             gpointer user_data)
+static void reset_statistics(GSimpleAction *action, GVariant *parameter,
+			     gpointer user_data)
 {
-	shutting_down = TRUE;
-	agent_release();
-	return FALSE;
+	stats_reset();
 }
 
+/* Not in any menu, for gapplication action and Ctrl+Shift+D */
+static const GActionEntry app_actions[] = {
+	{ "statistics", show_statistics, NULL, NULL, NULL, { 0 } },
+	{ "reset-statistics", reset_statistics, NULL, NULL, NULL, { 0 } },
+};
+
+/*
+ * Only the model and the status icon are set up here, the window is built
+ * the first time it is shown
+ */
 static void startup(GtkApplication *app, gpointer user_data)
 {
-	g_bus_get(G_BUS_TYPE_SYSTEM, NULL, dbus_connected, NULL);
+	watchdog_start();
+	hosts_init();
+	metrics_start(hosts);
+	g_action_map_add_action_entries(G_ACTION_MAP(app), app_actions,
+					G_N_ELEMENTS(app_actions), NULL);
 
+	profile_begin("config_load");
 	config_load(app);
+	profile_end("config_load");
 	if(no_icon)
 		status_icon_enabled = FALSE;
 
-	main_window = gtk_application_window_new(app);
-	g_signal_connect(app, "window-removed",
-	                 G_CALLBACK(delete_event), NULL);
-	gtk_window_set_title(GTK_WINDOW(main_window), _("Network Settings"));
-	gtk_window_set_default_size(GTK_WINDOW(main_window), DEFAULT_WIDTH,
-	                            DEFAULT_HEIGHT);
-
-	create_content();
-
-	g_signal_connect(G_OBJECT(main_window), "key_press_event", G_CALLBACK(handle_keyboard_shortcut), NULL);
-	gtk_widget_show_all(main_window);
-
 #ifdef USE_STATUS_ICON
-	if(status_icon_enabled && !no_icon) {
-		if(launch_to_tray)
-			gtk_widget_hide(main_window);
-
-		g_signal_connect(main_window, "delete-event",
-				 G_CALLBACK(gtk_widget_hide_on_delete),
-				 main_window);
+	if(status_icon_enabled) {
+		/* keep running while only the status icon exists */
+		g_application_hold(G_APPLICATION(app));
+		profile_begin("status_init");
 		status_init(app);
-	}
+		profile_end("status_init");
+	} else
+		launch_to_tray = FALSE;
 #endif
+
+	if(profile_quit)
+		g_timeout_add_seconds(PROFILE_TIMEOUT, startup_timeout, NULL);
 }
 
 static void activate(GtkApplication *app, gpointer user_data)
 {
 #ifdef USE_STATUS_ICON
-	if(!launch_to_tray)
-		gtk_widget_show(main_window);
-	launch_to_tray = FALSE;
+	if(launch_to_tray) {
+		launch_to_tray = FALSE;
+		return;
+	}
 #endif
+	if(!main_window)
+		window_create(app);
+	gtk_window_present(GTK_WINDOW(main_window));
+}
+
+/* Show the page now if the technology exists, otherwise once it is added */
+static void select_page(const gchar *page)
+{
+	enum connection_type type = connection_type_from_string(page);
+	GtkWidget *row;
+
+	g_clear_pointer(&default_page, g_free);
+	if(type == CONNECTION_TYPE_UNKNOWN ||
+	   !current_host->technologies[type] || !main_window) {
+		default_page = g_strdup(page);
+		return;
+	}
+
+	row = current_host->technologies[type]->list_item->item;
+	gtk_list_box_select_row(GTK_LIST_BOX(list), GTK_LIST_BOX_ROW(row));
+}
+
+/*
+ * Runs in the primary instance, also for options forwarded from a second
+ * launch. Only the options without arg_data end up in the dict.
+ */
+static int command_line(GApplication *app, GApplicationCommandLine *cmdline,
+			gpointer user_data)
+{
+	GVariantDict *options;
+	const gchar *page;
+
+	options = g_application_command_line_get_options_dict(cmdline);
+	if(g_variant_dict_lookup(options, "page", "&s", &page))
+		select_page(page);
+
+	g_application_activate(app);
+	return 0;
 }
 
 /* Hide the options if support not compiled in and show a warning instead of
@@ -654,7 +527,7 @@ static void activate(GtkApplication *app, gpointer user_data)
 #endif
 
 static const GOptionEntry options[] = {
-	{ "page", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_STRING, &default_page,
+	{ "page", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_STRING, NULL,
 		NULL, NULL },
 	{ "no-icon", 0, STATUS_ICON_HIDDEN,
 		G_OPTION_ARG_NONE,
@@ -666,34 +539,97 @@ static const GOptionEntry options[] = {
 		G_OPTION_ARG_NONE,
 		&use_fsid,
 		"Use FSID with openconnect", NULL },
+	{ "host", 0, 0, G_OPTION_ARG_STRING_ARRAY, &host_addresses,
+		"Manage the ConnMan on the D-Bus at ADDRESS, can be repeated. "
+		"\"system\" is the local system bus", "ADDRESS" },
+	{ "record-trace", 0, 0, G_OPTION_ARG_FILENAME, &record_trace,
+		"Record the D-Bus traffic from the first host to FILE",
+		"FILE" },
+	{ "profile-startup", 0, 0, G_OPTION_ARG_NONE, &profile_startup,
+		"Print a breakdown of startup time on exit", NULL },
+	{ "profile-output", 0, 0, G_OPTION_ARG_FILENAME, &profile_output,
+		"Write the startup profile as JSON to FILE", "FILE" },
+	{ "profile-cycles", 0, 0, G_OPTION_ARG_INT, &profile_cycles,
+		"Run N cold starts and report percentiles", "N" },
+	{ "watchdog", 0, 0, G_OPTION_ARG_INT, &watchdog_threshold,
+		"Report main loop iterations longer than MS, dump the "
+		"statistics on SIGUSR1", "MS" },
+	{ "frame-log", 0, 0, G_OPTION_ARG_FILENAME, &frame_log,
+		"Log every frame of the windows to FILE, - for stdout",
+		"FILE" },
+	{ "metrics-file", 0, 0, G_OPTION_ARG_FILENAME, &metrics_file,
+		"Write Prometheus metrics to FILE for the textfile "
+		"collector", "FILE" },
+	{ "metrics-interval", 0, 0, G_OPTION_ARG_INT, &metrics_interval,
+		"Rewrite the metrics file every S seconds, default 15", "S" },
+	{ "profile-quit", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE,
+		&profile_quit, NULL, NULL },
 	{ NULL }
 };
 
+static gint handle_local_options(GApplication *app, GVariantDict *options,
+				 gpointer user_data)
+{
+	const gchar *program = user_data;
+
+	if(profile_cycles > 0)
+		return profile_run_cycles(program, launch_to_tray);
+
+	/*
+	 * measure a cold start, not a forward to a running instance, and
+	 * keep a set of hosts out of the instance managing the local one
+	 */
+	if(profile_startup || profile_output || profile_quit ||
+	   host_addresses)
+		g_application_set_flags(app, g_application_get_flags(app) |
+					G_APPLICATION_NON_UNIQUE);
+	return -1;
+}
+
 int main(int argc, char *argv[])
 {
 	GtkApplication *app;
 	int status;
 
+	profile_init();
+
 	setlocale(LC_ALL, "");
 	bindtextdomain(GETTEXT_PACKAGE, CONNMAN_GTK_LOCALEDIR);
 	bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
 	textdomain(GETTEXT_PACKAGE);
 
+	profile_begin("style_init");
 	style_init();
+	profile_end("style_init");
+	profile_begin("interfaces_init");
+	interfaces_init();
+	profile_end("interfaces_init");
 
-	technology_types = g_hash_table_new_full(g_str_hash, g_str_equal,
-	                   g_free, NULL);
-	services = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
-					 (GDestroyNotify)remove_service_struct);
-
-	app = gtk_application_new(NULL, G_APPLICATION_FLAGS_NONE);
+	app = gtk_application_new(APPLICATION_ID,
+				  G_APPLICATION_HANDLES_COMMAND_LINE);
 	g_application_add_main_option_entries(G_APPLICATION(app), options);
+	g_signal_connect(app, "handle-local-options",
+			 G_CALLBACK(handle_local_options), argv[0]);
 	g_signal_connect(app, "startup", G_CALLBACK(startup), NULL);
 	g_signal_connect(app, "activate", G_CALLBACK(activate), NULL);
+	g_signal_connect(app, "shutdown", G_CALLBACK(app_shutdown), NULL);
+	g_signal_connect(app, "command-line", G_CALLBACK(command_line), NULL);
 	status = g_application_run(G_APPLICATION(app), argc, argv);
 	g_object_unref(app);
+	frame_monitor_close();
+
+	if(hosts) {
+		g_ptr_array_foreach(hosts, (GFunc)host_save_snapshot, NULL);
+		g_ptr_array_foreach(hosts, (GFunc)host_free, NULL);
+		g_ptr_array_free(hosts, TRUE);
+		current_host = NULL;
+	}
+	profile_report();
+	if(startup_timed_out)
+		status = EXIT_FAILURE;
 
 	g_object_unref(css_provider);
+	interfaces_free();
 
 	return status;
 }
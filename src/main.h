@@ -24,14 +24,19 @@
 #include <gtk/gtk.h>
 #include <gio/gio.h>
 
-void modify_service(GDBusConnection *connection, const gchar *path,
-		    GVariant *parameters);
-void remove_service(const gchar *path);
+struct host;
+struct technology;
+
+void startup_call_begin(void);
+void startup_call_done(void);
+void window_add_technology(struct host *host, struct technology *tech);
+void window_technologies_added(struct host *host);
 
 extern gboolean shutting_down;
 extern GtkWidget *main_window;
 extern gboolean use_fsid;
-extern struct technology *technologies[];
+extern struct host *current_host;
+extern gchar *default_page;
 
 
 #endif /* _CONNMAN_GTK_MAIN_H */
@@ -0,0 +1,303 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "connection.h"
+#include "host.h"
+#include "metrics.h"
+#include "router.h"
+#include "service.h"
+#include "stats.h"
+#include "technology.h"
+
+/*
+ * Everything is read from the model the window already keeps, writing
+ * the file never makes a D-Bus call. The file is replaced by a rename,
+ * so the collector never sees half of it.
+ */
+
+gchar *metrics_file;
+gint metrics_interval = 15;
+
+static GPtrArray *metrics_hosts;
+static guint metrics_id;
+
+/* Label values escaped as the text format wants them */
+static void append_label(GString *str, const gchar *name,
+			 const gchar *value, gboolean first)
+{
+	const gchar *c;
+
+	g_string_append_printf(str, "%s%s=\"", first ? "" : ",", name);
+	for(c = value; *c; c++) {
+		if(*c == '\\' || *c == '"')
+			g_string_append_c(str, '\\');
+		if(*c == '\n')
+			g_string_append(str, "\\n");
+		else
+			g_string_append_c(str, *c);
+	}
+	g_string_append_c(str, '"');
+}
+
+static void append_header(GString *str, const gchar *name,
+			  const gchar *type, const gchar *help)
+{
+	g_string_append_printf(str, "# HELP connman_gtk_%s %s\n"
+			       "# TYPE connman_gtk_%s %s\n",
+			       name, help, name, type);
+}
+
+static void service_labels(GString *str, struct host *host,
+			   struct service *serv)
+{
+	gchar *name = service_get_property_string_raw(serv, "Name", NULL);
+
+	g_string_append_c(str, '{');
+	append_label(str, "host", host->label, TRUE);
+	append_label(str, "service", serv->path, FALSE);
+	append_label(str, "name", name, FALSE);
+	append_label(str, "type", connection_type_name(serv->type), FALSE);
+	g_string_append_c(str, '}');
+	g_free(name);
+}
+
+/* One metric of every service of every host, value_cb gives the value */
+static void append_services(GString *str, const gchar *metric,
+			    gdouble (*value_cb)(struct service *serv),
+			    gboolean with_state)
+{
+	guint i;
+
+	for(i = 0; i < metrics_hosts->len; i++) {
+		struct host *host = g_ptr_array_index(metrics_hosts, i);
+		GHashTableIter iter;
+		gpointer key, value;
+
+		g_hash_table_iter_init(&iter, host->services);
+		while(g_hash_table_iter_next(&iter, &key, &value)) {
+			struct service *serv = value;
+
+			g_string_append_printf(str, "connman_gtk_%s", metric);
+			service_labels(str, host, serv);
+			if(with_state) {
+				g_string_truncate(str, str->len - 1);
+				append_label(str, "state",
+					     service_state_name(serv->state),
+					     FALSE);
+				g_string_append_c(str, '}');
+			}
+			g_string_append_printf(str, " %g\n", value_cb(serv));
+		}
+	}
+}
+
+static gdouble service_one(struct service *serv)
+{
+	return 1;
+}
+
+static gdouble service_strength(struct service *serv)
+{
+	return serv->strength;
+}
+
+static gdouble service_state_seconds(struct service *serv)
+{
+	return (gdouble)(g_get_monotonic_time() - serv->state_since) /
+	       G_USEC_PER_SEC;
+}
+
+static gdouble service_attempts(struct service *serv)
+{
+	return serv->connect_attempts;
+}
+
+static gdouble service_failures(struct service *serv)
+{
+	return serv->connect_failures;
+}
+
+static void append_technologies(GString *str, const gchar *metric,
+				const gchar *property)
+{
+	guint i;
+	int type;
+
+	for(i = 0; i < metrics_hosts->len; i++) {
+		struct host *host = g_ptr_array_index(metrics_hosts, i);
+
+		for(type = 0; type < CONNECTION_TYPE_COUNT; type++) {
+			struct technology *tech = host->technologies[type];
+
+			if(!tech || type == CONNECTION_TYPE_VPN)
+				continue;
+			g_string_append_printf(str, "connman_gtk_%s{", metric);
+			append_label(str, "host", host->label, TRUE);
+			append_label(str, "technology",
+				     connection_type_name(tech->type), FALSE);
+			g_string_append_printf(str, "} %d\n",
+				technology_get_property_bool(tech, property));
+		}
+	}
+}
+
+/* The handler statistics as Prometheus histograms in seconds */
+static void append_handlers(GString *str)
+{
+	enum stats_handler handler;
+	guint i;
+
+	append_header(str, "handler_duration_seconds", "histogram",
+		      "Time spent in the signal and agent handlers.");
+	for(handler = 0; handler < STATS_HANDLER_COUNT; handler++) {
+		const struct stats_entry *entry = stats_get(handler);
+		const gchar *name = stats_handler_name(handler);
+		guint64 count = 0;
+
+		for(i = 0; i < STATS_BUCKETS - 1; i++) {
+			count += entry->buckets[i];
+			g_string_append(str, "connman_gtk_handler_duration_"
+					"seconds_bucket{");
+			append_label(str, "handler", name, TRUE);
+			g_string_append_printf(str, ",le=\"%g\"} %"
+					       G_GUINT64_FORMAT "\n",
+					       (gdouble)((guint64)1 << i) /
+					       G_USEC_PER_SEC, count);
+		}
+		g_string_append(str, "connman_gtk_handler_duration_seconds_"
+				"bucket{");
+		append_label(str, "handler", name, TRUE);
+		g_string_append_printf(str, ",le=\"+Inf\"} %" G_GUINT64_FORMAT
+				       "\n", entry->calls);
+		g_string_append(str, "connman_gtk_handler_duration_seconds_"
+				"sum{");
+		append_label(str, "handler", name, TRUE);
+		g_string_append_printf(str, "} %g\n",
+				       (gdouble)entry->total / G_USEC_PER_SEC);
+		g_string_append(str, "connman_gtk_handler_duration_seconds_"
+				"count{");
+		append_label(str, "handler", name, TRUE);
+		g_string_append_printf(str, "} %" G_GUINT64_FORMAT "\n",
+				       entry->calls);
+	}
+}
+
+static gchar *metrics_format(void)
+{
+	GString *str = g_string_new(NULL);
+	guint64 batches, deltas, stalls;
+	gint64 drain_time, stall_time;
+
+	append_header(str, "service_state", "gauge",
+		      "Always 1, the state is in the state label.");
+	append_services(str, "service_state", service_one, TRUE);
+	append_header(str, "service_strength", "gauge",
+		      "Signal strength of the service, 0 to 100.");
+	append_services(str, "service_strength", service_strength, FALSE);
+	append_header(str, "service_state_seconds", "gauge",
+		      "Seconds since the service entered its state.");
+	append_services(str, "service_state_seconds", service_state_seconds,
+			FALSE);
+	append_header(str, "service_connect_attempts_total", "counter",
+		      "Times the service left a disconnected state to "
+		      "connect.");
+	append_services(str, "service_connect_attempts_total",
+			service_attempts, FALSE);
+	append_header(str, "service_connect_failures_total", "counter",
+		      "Times the service entered the failure state.");
+	append_services(str, "service_connect_failures_total",
+			service_failures, FALSE);
+
+	append_header(str, "technology_powered", "gauge",
+		      "1 if the technology is powered.");
+	append_technologies(str, "technology_powered", "Powered");
+	append_header(str, "technology_connected", "gauge",
+		      "1 if the technology is connected.");
+	append_technologies(str, "technology_connected", "Connected");
+
+	router_drain_totals(&batches, &deltas, &drain_time);
+	append_header(str, "router_records_total", "counter",
+		      "Records decoded from ConnMan signals and handled.");
+	g_string_append_printf(str, "connman_gtk_router_records_total %"
+			       G_GUINT64_FORMAT "\n", deltas);
+	append_header(str, "router_batches_total", "counter",
+		      "Batches of records handled on the main thread.");
+	g_string_append_printf(str, "connman_gtk_router_batches_total %"
+			       G_GUINT64_FORMAT "\n", batches);
+	append_header(str, "router_seconds_total", "counter",
+		      "Time the main thread spent handling records.");
+	g_string_append_printf(str, "connman_gtk_router_seconds_total %g\n",
+			       (gdouble)drain_time / G_USEC_PER_SEC);
+
+	router_stall_totals(&stalls, &stall_time);
+	append_header(str, "router_stalls_total", "counter",
+		      "Times signal decoding found the queue to the main "
+		      "thread full.");
+	g_string_append_printf(str, "connman_gtk_router_stalls_total %"
+			       G_GUINT64_FORMAT "\n", stalls);
+	append_header(str, "router_stall_seconds_total", "counter",
+		      "Time signal decoding waited for the main thread.");
+	g_string_append_printf(str, "connman_gtk_router_stall_seconds_total "
+			       "%g\n", (gdouble)stall_time / G_USEC_PER_SEC);
+
+	append_handlers(str);
+	return g_string_free(str, FALSE);
+}
+
+static gboolean metrics_write(gpointer user_data)
+{
+	GError *error = NULL;
+	gchar *text;
+
+	text = metrics_format();
+	if(!g_file_set_contents(metrics_file, text, -1, &error)) {
+		g_warning("Failed to write metrics to %s: %s", metrics_file,
+			  error->message);
+		g_error_free(error);
+	}
+	g_free(text);
+	return G_SOURCE_CONTINUE;
+}
+
+void metrics_start(GPtrArray *hosts)
+{
+	if(!metrics_file || metrics_id)
+		return;
+	if(metrics_interval < 1)
+		metrics_interval = 1;
+
+	metrics_hosts = hosts;
+	metrics_id = g_timeout_add_seconds((guint)metrics_interval,
+					   metrics_write, NULL);
+}
+
+/* A last write, so the file does not lag behind at exit */
+void metrics_stop(void)
+{
+	if(!metrics_id)
+		return;
+	g_source_remove(metrics_id);
+	metrics_id = 0;
+	metrics_write(NULL);
+}
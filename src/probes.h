@@ -0,0 +1,66 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_PROBES_H
+#define _CONNMAN_GTK_PROBES_H
+
+#include "config.h"
+
+/*
+ * Static tracepoints, chosen with -Dprobes. With sdt they are USDT
+ * probes of provider connman_gtk for bpftrace and friends, with sysprof
+ * they are marks in the connman-gtk group of a sysprof capture. Without
+ * either they compile to nothing and their arguments are not evaluated.
+ * Every argument is a string.
+ */
+#if defined(USE_PROBES_SDT)
+#include <sys/sdt.h>
+
+#define PROBE1(probe, a) DTRACE_PROBE1(connman_gtk, probe, a)
+#define PROBE2(probe, a, b) DTRACE_PROBE2(connman_gtk, probe, a, b)
+#define PROBE3(probe, a, b, c) DTRACE_PROBE3(connman_gtk, probe, a, b, c)
+#elif defined(USE_PROBES_SYSPROF)
+#include <sysprof-capture.h>
+
+#define PROBE_MARK(probe, ...) \
+	sysprof_collector_mark_printf(SYSPROF_CAPTURE_CURRENT_TIME, 0, \
+				      "connman-gtk", #probe, __VA_ARGS__)
+#define PROBE1(probe, a) PROBE_MARK(probe, "%s", a)
+#define PROBE2(probe, a, b) PROBE_MARK(probe, "%s %s", a, b)
+#define PROBE3(probe, a, b, c) PROBE_MARK(probe, "%s %s %s", a, b, c)
+#else
+#define PROBE1(probe, a) do { } while(0)
+#define PROBE2(probe, a, b) do { } while(0)
+#define PROBE3(probe, a, b, c) do { } while(0)
+#endif
+
+/* A signal reached the router worker, before it is decoded */
+#define PROBE_SIGNAL(bus, path, member) PROBE3(signal, bus, path, member)
+#define PROBE_SERVICE_ADDED(path) PROBE1(service_added, path)
+#define PROBE_SERVICE_REMOVED(path) PROBE1(service_removed, path)
+#define PROBE_PROPERTY_UPDATED(path, key) PROBE2(property_updated, path, key)
+/* Connect, Disconnect, SetProperty and Scan, error is "" on success */
+#define PROBE_CALL_BEGIN(path, method) PROBE2(call_begin, path, method)
+#define PROBE_CALL_END(path, error) PROBE2(call_end, path, error)
+/* Agent input dialogs, result is "ok" or "cancel" */
+#define PROBE_DIALOG_OPEN(path) PROBE1(dialog_open, path)
+#define PROBE_DIALOG_CLOSE(path, result) PROBE2(dialog_close, path, result)
+
+#endif /* _CONNMAN_GTK_PROBES_H */
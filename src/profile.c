@@ -0,0 +1,317 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "profile.h"
+
+gboolean profile_startup;
+gboolean profile_quit;
+gchar *profile_output;
+gint profile_cycles;
+
+/*
+ * Phases are always recorded, there are only a few dozen of them and they
+ * are only reported when asked for. Marks are phases which start at
+ * profile_init(), so their duration is the time since startup.
+ */
+struct phase {
+	const gchar *name;
+	gint64 start;
+	gint64 end;
+};
+
+static gint64 profile_start;
+static GArray *phases;
+
+void profile_init(void)
+{
+	profile_start = g_get_monotonic_time();
+	phases = g_array_new(FALSE, FALSE, sizeof(struct phase));
+}
+
+void profile_begin(const gchar *phase)
+{
+	struct phase p = { phase, g_get_monotonic_time(), 0 };
+	g_array_append_val(phases, p);
+}
+
+void profile_end(const gchar *phase)
+{
+	int i;
+
+	for(i = phases->len - 1; i >= 0; i--) {
+		struct phase *p = &g_array_index(phases, struct phase, i);
+		if(!p->end && !strcmp(p->name, phase)) {
+			p->end = g_get_monotonic_time();
+			return;
+		}
+	}
+	g_warning("profile phase %s was never started", phase);
+}
+
+void profile_mark(const gchar *phase)
+{
+	struct phase p = { phase, profile_start, g_get_monotonic_time() };
+	g_array_append_val(phases, p);
+	g_debug("startup: %s after %.1f ms", phase,
+		(p.end - p.start) / 1000.0);
+}
+
+static gdouble ms(gint64 usec)
+{
+	return usec / 1000.0;
+}
+
+/* Peak resident set size in kilobytes */
+static long max_rss(void)
+{
+	struct rusage usage;
+
+	if(getrusage(RUSAGE_SELF, &usage))
+		return 0;
+	return usage.ru_maxrss;
+}
+
+static gboolean write_output(GString *str)
+{
+	GError *error = NULL;
+
+	if(!g_file_set_contents(profile_output, str->str, str->len, &error)) {
+		g_warning("Failed to write profile to %s: %s",
+			  profile_output, error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void profile_report(void)
+{
+	GString *str;
+	int i, n = 0;
+
+	/* the cycles report was already written */
+	if(profile_cycles > 0)
+		return;
+
+	if(profile_startup) {
+		printf("# max_rss_kb %ld\n", max_rss());
+		printf("# phase start_ms duration_ms\n");
+		for(i = 0; i < phases->len; i++) {
+			struct phase *p = &g_array_index(phases, struct phase,
+							 i);
+			if(!p->end)
+				continue;
+			printf("%s %.3f %.3f\n", p->name,
+			       ms(p->start - profile_start),
+			       ms(p->end - p->start));
+		}
+		fflush(stdout);
+	}
+
+	if(!profile_output)
+		return;
+
+	str = g_string_new(NULL);
+	g_string_append_printf(str, "{\n\t\"max_rss_kb\": %ld,\n"
+			       "\t\"phases\": [", max_rss());
+	for(i = 0; i < phases->len; i++) {
+		struct phase *p = &g_array_index(phases, struct phase, i);
+		if(!p->end)
+			continue;
+		g_string_append_printf(str, "%s\n\t\t{ \"name\": \"%s\", "
+				       "\"start_ms\": %.3f, "
+				       "\"duration_ms\": %.3f }",
+				       n++ ? "," : "", p->name,
+				       ms(p->start - profile_start),
+				       ms(p->end - p->start));
+	}
+	g_string_append(str, "\n\t]\n}\n");
+	write_output(str);
+	g_string_free(str, TRUE);
+}
+
+/* Durations of one phase over all cycles, in the order of first appearance */
+struct samples {
+	gchar *name;
+	GArray *values;
+};
+
+static void free_samples(gpointer data)
+{
+	struct samples *s = data;
+	g_free(s->name);
+	g_array_unref(s->values);
+	g_free(s);
+}
+
+static void add_sample(GPtrArray *all, const gchar *name, gdouble value)
+{
+	struct samples *s = NULL;
+	int i;
+
+	for(i = 0; i < all->len; i++) {
+		s = all->pdata[i];
+		if(!strcmp(s->name, name))
+			break;
+	}
+	if(i == all->len) {
+		s = g_malloc(sizeof(*s));
+		s->name = g_strdup(name);
+		s->values = g_array_new(FALSE, FALSE, sizeof(gdouble));
+		g_ptr_array_add(all, s);
+	}
+	g_array_append_val(s->values, value);
+}
+
+/* Phase durations go to all, the peak RSS of the run to rss */
+static gboolean parse_cycle(GPtrArray *all, GArray *rss, const gchar *out)
+{
+	gchar **lines;
+	gboolean found = FALSE;
+	int i;
+
+	lines = g_strsplit(out, "\n", -1);
+	for(i = 0; lines[i]; i++) {
+		gchar name[64];
+		gdouble start, duration, kb;
+
+		if(sscanf(lines[i], "# max_rss_kb %lf", &kb) == 1)
+			g_array_append_val(rss, kb);
+		if(lines[i][0] == '#')
+			continue;
+		if(sscanf(lines[i], "%63s %lf %lf", name, &start,
+			  &duration) != 3)
+			continue;
+		add_sample(all, name, duration);
+		found = TRUE;
+	}
+	g_strfreev(lines);
+	return found;
+}
+
+static gint compare_double(gconstpointer a, gconstpointer b)
+{
+	gdouble x = *(const gdouble *)a, y = *(const gdouble *)b;
+	return (x > y) - (x < y);
+}
+
+static gdouble percentile(GArray *sorted, int pct)
+{
+	int idx = (sorted->len * pct + 99) / 100 - 1;
+	if(idx < 0)
+		idx = 0;
+	return g_array_index(sorted, gdouble, idx);
+}
+
+/*
+ * Start the program cold cycles times, each run quits once the window is
+ * populated. Point DBUS_SYSTEM_BUS_ADDRESS at a mock bus for repeatable
+ * numbers. The peak RSS is reported after the phases, in kilobytes.
+ */
+int profile_run_cycles(const gchar *program, gboolean tray)
+{
+	const gchar *argv[] = { program, "--profile-startup",
+				"--profile-quit", tray ? "--tray" : NULL,
+				NULL };
+	GPtrArray *all;
+	GArray *rss;
+	GString *json;
+	int i, done = 0;
+
+	all = g_ptr_array_new_with_free_func(free_samples);
+	rss = g_array_new(FALSE, FALSE, sizeof(gdouble));
+	for(i = 0; i < profile_cycles; i++) {
+		GError *error = NULL;
+		gchar *out = NULL;
+		gint status;
+
+		if(!g_spawn_sync(NULL, (gchar **)argv, NULL,
+				 G_SPAWN_SEARCH_PATH, NULL, NULL, &out, NULL,
+				 &status, &error)) {
+			g_warning("Failed to run %s: %s", program,
+				  error->message);
+			g_error_free(error);
+			break;
+		}
+		if(!g_spawn_check_exit_status(status, NULL) ||
+		   !parse_cycle(all, rss, out))
+			g_warning("Startup cycle %d failed", i + 1);
+		else
+			done++;
+		g_free(out);
+	}
+
+	printf("# %d/%d cycles\n# phase p50_ms p90_ms p99_ms max_ms\n",
+	       done, profile_cycles);
+	json = g_string_new(NULL);
+	g_string_append_printf(json, "{\n\t\"cycles\": %d,\n\t\"phases\": [",
+			       done);
+	for(i = 0; i < all->len; i++) {
+		struct samples *s = all->pdata[i];
+
+		g_array_sort(s->values, compare_double);
+		printf("%s %.3f %.3f %.3f %.3f\n", s->name,
+		       percentile(s->values, 50), percentile(s->values, 90),
+		       percentile(s->values, 99), percentile(s->values, 100));
+		g_string_append_printf(json, "%s\n\t\t{ \"name\": \"%s\", "
+				       "\"samples\": %u, \"p50_ms\": %.3f, "
+				       "\"p90_ms\": %.3f, \"p99_ms\": %.3f, "
+				       "\"max_ms\": %.3f }",
+				       i ? "," : "", s->name, s->values->len,
+				       percentile(s->values, 50),
+				       percentile(s->values, 90),
+				       percentile(s->values, 99),
+				       percentile(s->values, 100));
+	}
+	g_string_append(json, "\n\t]");
+
+	if(rss->len) {
+		g_array_sort(rss, compare_double);
+		printf("# max_rss p50_kb p90_kb p99_kb max_kb\n"
+		       "max_rss %.0f %.0f %.0f %.0f\n",
+		       percentile(rss, 50), percentile(rss, 90),
+		       percentile(rss, 99), percentile(rss, 100));
+		g_string_append_printf(json, ",\n\t\"max_rss_kb\": { "
+				       "\"samples\": %u, \"p50\": %.0f, "
+				       "\"p90\": %.0f, \"p99\": %.0f, "
+				       "\"max\": %.0f }",
+				       rss->len, percentile(rss, 50),
+				       percentile(rss, 90),
+				       percentile(rss, 99),
+				       percentile(rss, 100));
+	}
+	g_string_append(json, "\n}\n");
+
+	if(profile_output)
+		write_output(json);
+
+	g_string_free(json, TRUE);
+	g_ptr_array_free(all, TRUE);
+	g_array_free(rss, TRUE);
+	return done == profile_cycles ? EXIT_SUCCESS : EXIT_FAILURE;
+}
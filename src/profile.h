@@ -0,0 +1,41 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_PROFILE_H
+#define _CONNMAN_GTK_PROFILE_H
+
+#include <glib.h>
+
+/* seconds a --profile-quit run may take before giving up */
+#define PROFILE_TIMEOUT 30
+
+extern gboolean profile_startup;
+extern gboolean profile_quit;
+extern gchar *profile_output;
+extern gint profile_cycles;
+
+void profile_init(void);
+void profile_begin(const gchar *phase);
+void profile_end(const gchar *phase);
+void profile_mark(const gchar *phase);
+void profile_report(void);
+int profile_run_cycles(const gchar *program, gboolean tray);
+
+#endif /* _CONNMAN_GTK_PROFILE_H */
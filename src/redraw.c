@@ -0,0 +1,170 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "main.h"
+#include "redraw.h"
+#include "service.h"
+#include "stats.h"
+#include "status.h"
+#include "technology.h"
+
+/*
+ * The frame clock stops while the window is iconified, the timeout
+ * flushes in its place so the status icon does not fall behind
+ */
+#define REDRAW_FALLBACK 100
+
+static GHashTable *services;
+static GHashTable *technologies;
+static gboolean status_dirty;
+static gboolean flushing;
+
+static GtkWidget *tick_widget;
+static guint tick_id;
+static guint source_id;
+
+static gboolean pending(void)
+{
+	return status_dirty || g_hash_table_size(services) ||
+	       g_hash_table_size(technologies);
+}
+
+static void cancel(void)
+{
+	if(source_id) {
+		g_source_remove(source_id);
+		source_id = 0;
+	}
+	/* a window destroyed meanwhile took its callbacks along */
+	if(tick_id && tick_widget == main_window)
+		gtk_widget_remove_tick_callback(tick_widget, tick_id);
+	tick_id = 0;
+}
+
+static gboolean flush_tick(GtkWidget *widget, GdkFrameClock *clock,
+			   gpointer user_data)
+{
+	tick_id = 0;
+	redraw_flush();
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean flush_source(gpointer user_data)
+{
+	source_id = 0;
+	redraw_flush();
+	return G_SOURCE_REMOVE;
+}
+
+static void schedule(void)
+{
+	if(source_id || flushing)
+		return;
+
+	if(main_window && gtk_widget_get_mapped(main_window)) {
+		tick_widget = main_window;
+		tick_id = gtk_widget_add_tick_callback(main_window, flush_tick,
+						       NULL, NULL);
+		source_id = g_timeout_add_full(G_PRIORITY_LOW, REDRAW_FALLBACK,
+					       flush_source, NULL, NULL);
+	} else
+		source_id = g_idle_add_full(G_PRIORITY_LOW, flush_source, NULL,
+					    NULL);
+}
+
+static void init(void)
+{
+	if(services)
+		return;
+	services = g_hash_table_new(g_direct_hash, g_direct_equal);
+	technologies = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+void redraw_service(struct service *serv)
+{
+	init();
+	g_hash_table_add(services, serv);
+	schedule();
+}
+
+void redraw_technology(struct technology *tech)
+{
+	init();
+	g_hash_table_add(technologies, tech);
+	schedule();
+}
+
+void redraw_status(void)
+{
+	init();
+	status_dirty = TRUE;
+	schedule();
+}
+
+void redraw_forget_service(struct service *serv)
+{
+	if(services)
+		g_hash_table_remove(services, serv);
+}
+
+void redraw_forget_technology(struct technology *tech)
+{
+	if(technologies)
+		g_hash_table_remove(technologies, tech);
+}
+
+void redraw_flush(void)
+{
+	gint64 start = stats_begin();
+	GHashTableIter iter;
+	gpointer key;
+
+	cancel();
+	if(!services || !pending())
+		return;
+
+	/* technologies are marked by their services, and redrawn after */
+	flushing = TRUE;
+	g_hash_table_iter_init(&iter, services);
+	while(g_hash_table_iter_next(&iter, &key, NULL)) {
+		struct service *serv = key;
+
+		service_redraw(serv);
+		technology_service_updated(serv->tech, serv);
+	}
+	g_hash_table_remove_all(services);
+
+	g_hash_table_iter_init(&iter, technologies);
+	while(g_hash_table_iter_next(&iter, &key, NULL))
+		technology_redraw(key);
+	g_hash_table_remove_all(technologies);
+
+	if(status_dirty) {
+		status_dirty = FALSE;
+		status_update();
+	}
+	flushing = FALSE;
+	if(pending())
+		schedule();
+	stats_end(STATS_REDRAW_FLUSH, start);
+}
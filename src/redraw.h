@@ -0,0 +1,43 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_REDRAW_H
+#define _CONNMAN_GTK_REDRAW_H
+
+#include <gtk/gtk.h>
+
+struct service;
+struct technology;
+
+/*
+ * Signals only mark what they changed. The marked services, their
+ * technologies and the status icon are redrawn together in the update
+ * phase of the next frame of the main window, or from a low priority
+ * idle when the window is not shown, so a service is redrawn once and
+ * status_update() runs once however many signals arrived in between.
+ */
+void redraw_service(struct service *serv);
+void redraw_technology(struct technology *tech);
+void redraw_status(void);
+void redraw_forget_service(struct service *serv);
+void redraw_forget_technology(struct technology *tech);
+void redraw_flush(void);
+
+#endif /* _CONNMAN_GTK_REDRAW_H */
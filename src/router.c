@@ -0,0 +1,708 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "probes.h"
+#include "router.h"
+#include "trace.h"
+
+/* Must be a power of two */
+#define ROUTER_QUEUE_SIZE 1024
+/* Records handled per main loop iteration, so a storm cannot stall drawing */
+#define ROUTER_DRAIN_BATCH 256
+
+struct route {
+	router_cb cb;
+	gpointer user_data;
+};
+
+struct route_table {
+	gchar *name;
+	/* only touched from the worker thread */
+	guint id;
+	GHashTable *routes;
+};
+
+struct router {
+	GDBusConnection *connection;
+	GHashTable *tables;
+
+	GMainContext *worker_context;
+	GMainLoop *worker_loop;
+	GThread *worker;
+	gint stopping;
+
+	/*
+	 * Single producer, single consumer ring. Only the worker writes
+	 * tail and only the main thread writes head.
+	 */
+	struct router_delta *queue[ROUTER_QUEUE_SIZE];
+	gint head;
+	gint tail;
+	gint wake_pending;
+	GSource *wake;
+
+	/* the worker waits here while the queue is full */
+	GMutex space_lock;
+	GCond space;
+	gint space_wanted;
+
+	/* set before subscribing, written from the worker */
+	struct trace *trace;
+};
+
+struct subscription {
+	struct router *router;
+	struct route_table *table;
+};
+
+/* Lives from router_call until the reply is handed to the callback */
+struct router_reply {
+	/* first, the queue holds it as a delta */
+	struct router_delta delta;
+	struct router *router;
+	const gchar *interface;
+	GVariant *parameters;
+	GCancellable *cancellable;
+	GError *error;
+	router_reply_cb cb;
+	gpointer user_data;
+};
+
+static gint match_rules;
+/* totals over every router, only touched from the main thread */
+static guint64 drained_batches;
+static guint64 drained_deltas;
+static gint64 drain_time;
+/* times a worker found the queue full, and the us it waited */
+static GMutex stall_lock;
+static guint64 stalls;
+static gint64 stall_time;
+
+static void reply_free(struct router_reply *reply)
+{
+	if(reply->parameters)
+		g_variant_unref(reply->parameters);
+	if(reply->cancellable)
+		g_object_unref(reply->cancellable);
+	if(reply->error)
+		g_error_free(reply->error);
+}
+
+static void delta_free(struct router_delta *delta)
+{
+	guint i;
+
+	if(delta->kind == ROUTER_DELTA_REPLY)
+		reply_free((struct router_reply *)delta);
+	for(i = 0; i < delta->n_properties; i++)
+		g_variant_unref(delta->properties[i].value);
+	g_free(delta->properties);
+	g_free(delta->path);
+	g_free(delta->object);
+	if(delta->value)
+		g_variant_unref(delta->value);
+	g_free(delta);
+}
+
+static gboolean queue_push(struct router *router, struct router_delta *delta)
+{
+	gint tail = router->tail;
+	gint head = g_atomic_int_get(&router->head);
+
+	if((guint)(tail - head) == ROUTER_QUEUE_SIZE)
+		return FALSE;
+	router->queue[tail & (ROUTER_QUEUE_SIZE - 1)] = delta;
+	g_atomic_int_set(&router->tail, tail + 1);
+	return TRUE;
+}
+
+static gboolean queue_full(struct router *router)
+{
+	return (guint)(router->tail - g_atomic_int_get(&router->head)) ==
+	       ROUTER_QUEUE_SIZE;
+}
+
+static struct router_delta *queue_pop(struct router *router)
+{
+	gint head = router->head;
+	gint tail = g_atomic_int_get(&router->tail);
+	struct router_delta *delta;
+
+	if(head == tail)
+		return NULL;
+	delta = router->queue[head & (ROUTER_QUEUE_SIZE - 1)];
+	g_atomic_int_set(&router->head, head + 1);
+	return delta;
+}
+
+static void record_stall(gint64 time)
+{
+	g_mutex_lock(&stall_lock);
+	stalls++;
+	stall_time += time;
+	g_mutex_unlock(&stall_lock);
+	g_debug("Router queue full, signals waited %.1f ms",
+		(gdouble)time / 1000);
+}
+
+/*
+ * Waits until the main thread has drained some of a full queue. The flag
+ * is set before the queue is looked at again, and drain_queue pops before
+ * looking at the flag, so one of them always sees the other.
+ */
+static void wait_for_space(struct router *router)
+{
+	g_mutex_lock(&router->space_lock);
+	g_atomic_int_set(&router->space_wanted, 1);
+	while(queue_full(router) && !g_atomic_int_get(&router->stopping))
+		g_cond_wait(&router->space, &router->space_lock);
+	g_mutex_unlock(&router->space_lock);
+}
+
+/* Worker side, wakes the main thread unless a wakeup is already pending */
+static void queue_delta(struct router *router, struct router_delta *delta)
+{
+	gint64 stall_start = 0;
+
+	/* a full queue holds the worker back, and with it the bus socket */
+	while(!queue_push(router, delta)) {
+		if(g_atomic_int_get(&router->stopping)) {
+			delta_free(delta);
+			return;
+		}
+		if(!stall_start)
+			stall_start = g_get_monotonic_time();
+		wait_for_space(router);
+	}
+	if(stall_start)
+		record_stall(g_get_monotonic_time() - stall_start);
+
+	if(g_atomic_int_compare_and_exchange(&router->wake_pending, 0, 1))
+		g_source_set_ready_time(router->wake, 0);
+}
+
+static struct router_delta *delta_new(enum router_delta_kind kind,
+				      const gchar *name, const gchar *signal,
+				      const gchar *path)
+{
+	struct router_delta *delta = g_malloc0(sizeof(*delta));
+
+	delta->kind = kind;
+	delta->name = name;
+	delta->signal = signal;
+	delta->path = g_strdup(path);
+	return delta;
+}
+
+/* Leaves the main thread nothing to look up in the a{sv} but values */
+static void split_properties(struct router_delta *delta)
+{
+	struct router_property property;
+	GVariantIter iter, fields;
+	const gchar *key, *subkey;
+	GVariant *value, *field;
+	GArray *properties;
+
+	properties = g_array_sized_new(FALSE, FALSE, sizeof(property),
+				       g_variant_n_children(delta->value));
+	g_variant_iter_init(&iter, delta->value);
+	while(g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+		property.key = g_intern_string(key);
+		if(!g_variant_is_of_type(value, G_VARIANT_TYPE_VARDICT)) {
+			property.subkey = NULL;
+			property.value = value;
+			g_array_append_val(properties, property);
+			continue;
+		}
+
+		g_variant_iter_init(&fields, value);
+		while(g_variant_iter_next(&fields, "{&sv}", &subkey, &field)) {
+			property.subkey = g_intern_string(subkey);
+			property.value = field;
+			g_array_append_val(properties, property);
+		}
+		g_variant_unref(value);
+	}
+	delta->n_properties = properties->len;
+	delta->properties = (struct router_property *)
+			    g_array_free(properties, FALSE);
+}
+
+/* Splits ServicesChanged style signals to a record per object */
+static GSList *decode_objects(GSList *out, const gchar *name,
+			      const gchar *signal, const gchar *path,
+			      GVariant *parameters)
+{
+	GVariantIter *modified, *removed;
+	const gchar *object;
+	GVariant *properties;
+
+	g_variant_get(parameters, "(a(oa{sv})ao)", &modified, &removed);
+
+	while(g_variant_iter_next(modified, "(&o@a{sv})", &object,
+				  &properties)) {
+		struct router_delta *delta;
+
+		delta = delta_new(ROUTER_DELTA_CHANGED, name, signal, path);
+		delta->object = g_strdup(object);
+		delta->value = properties;
+		split_properties(delta);
+		out = g_slist_prepend(out, delta);
+	}
+
+	while(g_variant_iter_next(removed, "&o", &object)) {
+		struct router_delta *delta;
+
+		delta = delta_new(ROUTER_DELTA_REMOVED, name, signal, path);
+		delta->object = g_strdup(object);
+		out = g_slist_prepend(out, delta);
+	}
+
+	g_variant_iter_free(modified);
+	g_variant_iter_free(removed);
+	return out;
+}
+
+/* Returns the records of the signal in the order they are to be applied */
+static GSList *decode_signal(const gchar *name, const gchar *path,
+			     const gchar *signal, GVariant *parameters)
+{
+	const GVariantType *type = g_variant_get_type(parameters);
+	struct router_delta *delta;
+	const gchar *object;
+	GSList *out = NULL;
+
+	if(g_variant_type_equal(type, G_VARIANT_TYPE("(sv)"))) {
+		const gchar *property;
+
+		delta = delta_new(ROUTER_DELTA_PROPERTY, name, signal, path);
+		g_variant_get(parameters, "(&sv)", &property, &delta->value);
+		delta->property = g_intern_string(property);
+		out = g_slist_prepend(out, delta);
+	} else if(g_variant_type_equal(type, G_VARIANT_TYPE("(oa{sv})"))) {
+		delta = delta_new(ROUTER_DELTA_ADDED, name, signal, path);
+		g_variant_get(parameters, "(&o@a{sv})", &object,
+			      &delta->value);
+		delta->object = g_strdup(object);
+		out = g_slist_prepend(out, delta);
+	} else if(g_variant_type_equal(type, G_VARIANT_TYPE("(o)"))) {
+		delta = delta_new(ROUTER_DELTA_REMOVED, name, signal, path);
+		g_variant_get(parameters, "(&o)", &object);
+		delta->object = g_strdup(object);
+		out = g_slist_prepend(out, delta);
+	} else if(g_variant_type_equal(type,
+				       G_VARIANT_TYPE("(a(oa{sv})ao)"))) {
+		out = decode_objects(out, name, signal, path, parameters);
+	} else {
+		g_debug("Ignoring %s of type %s from %s", signal,
+			g_variant_get_type_string(parameters), path);
+	}
+
+	if(out)
+		((struct router_delta *)out->data)->last = TRUE;
+	return g_slist_reverse(out);
+}
+
+/* Runs on the worker thread */
+static void route_signal(GDBusConnection *connection, const gchar *sender,
+			 const gchar *path, const gchar *interface,
+			 const gchar *signal, GVariant *parameters,
+			 gpointer user_data)
+{
+	struct subscription *sub = user_data;
+	GSList *deltas, *l;
+
+	PROBE_SIGNAL(sub->table->name, path, signal);
+	trace_write(sub->router->trace, TRACE_SIGNAL, sub->table->name, path,
+		    interface, signal, parameters);
+	deltas = decode_signal(sub->table->name, path,
+			       g_intern_string(signal), parameters);
+	for(l = deltas; l; l = l->next)
+		queue_delta(sub->router, l->data);
+	g_slist_free(deltas);
+}
+
+static void dispatch_reply(struct router_reply *reply)
+{
+	GError *cancelled = NULL;
+
+	/* cancelled while it waited in the queue */
+	if(!reply->error &&
+	   g_cancellable_set_error_if_cancelled(reply->cancellable,
+						&cancelled)) {
+		reply->cb(NULL, cancelled, reply->user_data);
+		g_error_free(cancelled);
+		return;
+	}
+	reply->cb(reply->delta.value, reply->error, reply->user_data);
+}
+
+static void dispatch_delta(struct router *router, struct router_delta *delta)
+{
+	struct route_table *table;
+	struct route *route;
+
+	if(delta->kind == ROUTER_DELTA_REPLY) {
+		dispatch_reply((struct router_reply *)delta);
+		delta_free(delta);
+		return;
+	}
+
+	table = g_hash_table_lookup(router->tables, delta->name);
+	route = table ? g_hash_table_lookup(table->routes, delta->path) : NULL;
+	if(route)
+		route->cb(delta, route->user_data);
+	delta_free(delta);
+}
+
+static gboolean drain_queue(gpointer user_data)
+{
+	struct router *router = user_data;
+	struct router_delta *delta;
+	gint64 start = g_get_monotonic_time();
+	int i;
+
+	g_atomic_int_set(&router->wake_pending, 0);
+	for(i = 0; i < ROUTER_DRAIN_BATCH; i++) {
+		delta = queue_pop(router);
+		if(!delta)
+			break;
+		dispatch_delta(router, delta);
+	}
+	if(i && g_atomic_int_get(&router->space_wanted)) {
+		g_mutex_lock(&router->space_lock);
+		g_atomic_int_set(&router->space_wanted, 0);
+		g_cond_signal(&router->space);
+		g_mutex_unlock(&router->space_lock);
+	}
+	drained_batches++;
+	drained_deltas += (guint)i;
+	drain_time += g_get_monotonic_time() - start;
+	if(i < ROUTER_DRAIN_BATCH)
+		return G_SOURCE_CONTINUE;
+
+	/* more left, let the main loop draw before handling the rest */
+	g_atomic_int_set(&router->wake_pending, 1);
+	g_source_set_ready_time(router->wake, 0);
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean wake_dispatch(GSource *source, GSourceFunc callback,
+			      gpointer user_data)
+{
+	g_source_set_ready_time(source, -1);
+	return callback(user_data);
+}
+
+static GSourceFuncs wake_funcs = {
+	.dispatch = wake_dispatch,
+};
+
+static gpointer worker_run(gpointer user_data)
+{
+	struct router *router = user_data;
+
+	g_main_context_push_thread_default(router->worker_context);
+	g_main_loop_run(router->worker_loop);
+	/* let the unsubscribed handlers release their data */
+	while(g_main_context_iteration(router->worker_context, FALSE));
+	g_main_context_pop_thread_default(router->worker_context);
+	return NULL;
+}
+
+/*
+ * GDBus delivers a signal in the main context that was the thread default
+ * when subscribing, so subscriptions are made from the worker
+ */
+static gboolean worker_subscribe(gpointer user_data)
+{
+	struct subscription *sub = user_data;
+	struct route_table *table = sub->table;
+	struct subscription *data;
+
+	if(table->id)
+		return G_SOURCE_REMOVE;
+
+	/*
+	 * Matching on the sender alone covers every object the daemon
+	 * exports, from the managers at / to everything under /net/connman,
+	 * so a path_namespace would not narrow the rule any further.
+	 */
+	data = g_malloc(sizeof(*data));
+	*data = *sub;
+	table->id = g_dbus_connection_signal_subscribe(sub->router->connection,
+						       table->name, NULL, NULL,
+						       NULL, NULL,
+						       G_DBUS_SIGNAL_FLAGS_NONE,
+						       route_signal, data,
+						       g_free);
+	g_debug("%d signal match rules after subscribing to %s",
+		g_atomic_int_add(&match_rules, 1) + 1, table->name);
+	return G_SOURCE_REMOVE;
+}
+
+static void route_table_unsubscribe(struct router *router,
+				    struct route_table *table)
+{
+	if(!table->id)
+		return;
+	g_dbus_connection_signal_unsubscribe(router->connection, table->id);
+	table->id = 0;
+	g_atomic_int_add(&match_rules, -1);
+}
+
+static gboolean worker_unsubscribe(gpointer user_data)
+{
+	struct subscription *sub = user_data;
+
+	route_table_unsubscribe(sub->router, sub->table);
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean worker_stop(gpointer user_data)
+{
+	struct router *router = user_data;
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, router->tables);
+	while(g_hash_table_iter_next(&iter, NULL, &value))
+		route_table_unsubscribe(router, value);
+	g_main_loop_quit(router->worker_loop);
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Runs on the worker thread. GDBus hands the reply and the signals to the
+ * worker context in the order they came off the bus, so queueing it here
+ * keeps it in line with them.
+ */
+static void call_done(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	struct router_reply *reply = user_data;
+	struct router_delta *delta = &reply->delta;
+
+	delta->value = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+						     res, &reply->error);
+	if(delta->value)
+		trace_write(reply->router->trace, TRACE_REPLY, delta->name,
+			    delta->path, reply->interface, delta->signal,
+			    delta->value);
+	queue_delta(reply->router, delta);
+}
+
+static gboolean worker_call(gpointer user_data)
+{
+	struct router_reply *reply = user_data;
+
+	g_dbus_connection_call(reply->router->connection, reply->delta.name,
+			       reply->delta.path, reply->interface,
+			       reply->delta.signal, reply->parameters, NULL,
+			       G_DBUS_CALL_FLAGS_NONE, -1, reply->cancellable,
+			       call_done, reply);
+	return G_SOURCE_REMOVE;
+}
+
+static void worker_invoke(struct router *router, GSourceFunc func,
+			  struct route_table *table)
+{
+	struct subscription *sub = g_malloc(sizeof(*sub));
+
+	sub->router = router;
+	sub->table = table;
+	g_main_context_invoke_full(router->worker_context, G_PRIORITY_DEFAULT,
+				   func, sub, g_free);
+}
+
+static struct route_table *route_table_new(struct router *router,
+					   const gchar *name)
+{
+	struct route_table *table = g_malloc(sizeof(*table));
+
+	/* interned, the records carry it without copying */
+	table->name = (gchar *)g_intern_string(name);
+	table->id = 0;
+	table->routes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					      g_free);
+	g_hash_table_insert(router->tables, table->name, table);
+	return table;
+}
+
+static struct route_table *route_table_get(struct router *router,
+					   const gchar *name)
+{
+	struct route_table *table = g_hash_table_lookup(router->tables, name);
+	if(!table)
+		table = route_table_new(router, name);
+	return table;
+}
+
+struct router *router_new(GDBusConnection *connection)
+{
+	struct router *router = g_malloc0(sizeof(*router));
+
+	router->connection = g_object_ref(connection);
+	router->tables = g_hash_table_new(g_str_hash, g_str_equal);
+	g_mutex_init(&router->space_lock);
+	g_cond_init(&router->space);
+
+	router->wake = g_source_new(&wake_funcs, sizeof(GSource));
+	g_source_set_callback(router->wake, drain_queue, router, NULL);
+	g_source_attach(router->wake, g_main_context_get_thread_default());
+
+	router->worker_context = g_main_context_new();
+	router->worker_loop = g_main_loop_new(router->worker_context, FALSE);
+	router->worker = g_thread_new("router", worker_run, router);
+	return router;
+}
+
+void router_free(struct router *router)
+{
+	struct router_delta *delta;
+	GHashTableIter iter;
+	gpointer value;
+
+	if(!router)
+		return;
+
+	g_atomic_int_set(&router->stopping, 1);
+	g_mutex_lock(&router->space_lock);
+	g_cond_signal(&router->space);
+	g_mutex_unlock(&router->space_lock);
+	g_main_context_invoke(router->worker_context, worker_stop, router);
+	g_thread_join(router->worker);
+	g_main_loop_unref(router->worker_loop);
+	g_main_context_unref(router->worker_context);
+
+	while((delta = queue_pop(router)))
+		delta_free(delta);
+	g_source_destroy(router->wake);
+	g_source_unref(router->wake);
+
+	g_hash_table_iter_init(&iter, router->tables);
+	while(g_hash_table_iter_next(&iter, NULL, &value)) {
+		struct route_table *table = value;
+
+		g_hash_table_unref(table->routes);
+		g_free(table);
+	}
+	g_hash_table_unref(router->tables);
+	g_object_unref(router->connection);
+	g_mutex_clear(&router->space_lock);
+	g_cond_clear(&router->space);
+	g_free(router);
+}
+
+GDBusConnection *router_get_connection(struct router *router)
+{
+	return router->connection;
+}
+
+/* Record every signal received, call before subscribing */
+void router_set_trace(struct router *router, struct trace *trace)
+{
+	router->trace = trace;
+}
+
+void router_subscribe(struct router *router, const gchar *name)
+{
+	worker_invoke(router, worker_subscribe, route_table_get(router, name));
+}
+
+void router_unsubscribe(struct router *router, const gchar *name)
+{
+	struct route_table *table = g_hash_table_lookup(router->tables, name);
+
+	if(table)
+		worker_invoke(router, worker_unsubscribe, table);
+}
+
+void router_add(struct router *router, const gchar *name, const gchar *path,
+		router_cb cb, gpointer user_data)
+{
+	struct route_table *table = route_table_get(router, name);
+	struct route *route = g_malloc(sizeof(*route));
+
+	route->cb = cb;
+	route->user_data = user_data;
+	g_hash_table_replace(table->routes, g_strdup(path), route);
+}
+
+void router_remove(struct router *router, const gchar *name,
+		   const gchar *path)
+{
+	struct route_table *table = g_hash_table_lookup(router->tables, name);
+
+	if(table)
+		g_hash_table_remove(table->routes, path);
+}
+
+/*
+ * Call a method from the worker. The reply is queued with the signals and
+ * cb runs from the main thread once everything received before it has
+ * been handled.
+ */
+void router_call(struct router *router, const gchar *name, const gchar *path,
+		 const gchar *interface, const gchar *method,
+		 GVariant *parameters, GCancellable *cancellable,
+		 router_reply_cb cb, gpointer user_data)
+{
+	struct router_reply *reply = g_malloc0(sizeof(*reply));
+
+	reply->delta.kind = ROUTER_DELTA_REPLY;
+	reply->delta.name = g_intern_string(name);
+	reply->delta.signal = g_intern_string(method);
+	reply->delta.path = g_strdup(path);
+	reply->delta.last = TRUE;
+	reply->router = router;
+	reply->interface = g_intern_string(interface);
+	if(parameters)
+		reply->parameters = g_variant_ref_sink(parameters);
+	if(cancellable)
+		reply->cancellable = g_object_ref(cancellable);
+	reply->cb = cb;
+	reply->user_data = user_data;
+	g_main_context_invoke(router->worker_context, worker_call, reply);
+}
+
+/* Batches and records handled on the main thread so far, and the us spent */
+void router_drain_totals(guint64 *batches, guint64 *deltas, gint64 *time)
+{
+	*batches = drained_batches;
+	*deltas = drained_deltas;
+	*time = drain_time;
+}
+
+/* Times the workers found their queue full so far, and the us they waited */
+void router_stall_totals(guint64 *count, gint64 *time)
+{
+	g_mutex_lock(&stall_lock);
+	*count = stalls;
+	*time = stall_time;
+	g_mutex_unlock(&stall_lock);
+}
+
+guint router_match_rule_count(void)
+{
+	return g_atomic_int_get(&match_rules);
+}
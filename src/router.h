@@ -0,0 +1,109 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_ROUTER_H
+#define _CONNMAN_GTK_ROUTER_H
+
+#include <gio/gio.h>
+#include <glib.h>
+
+/*
+ * Routes every signal of a bus name through a single match rule and hands
+ * it to the handler registered for the object path it was emitted from.
+ *
+ * Signals are received and unpacked on a worker thread with its own main
+ * context. Each one is turned into one or more delta records which are
+ * queued to the main thread, where the handlers run.
+ *
+ * Replies to router_call come through the same queue, so a signal sent
+ * after the reply is handled after its callback, never before it.
+ */
+
+enum router_delta_kind {
+	/* PropertyChanged of the emitting object, value is unboxed */
+	ROUTER_DELTA_PROPERTY,
+	/* object announced with its a{sv} properties */
+	ROUTER_DELTA_ADDED,
+	/* properties of an object listed in ServicesChanged */
+	ROUTER_DELTA_CHANGED,
+	/* object removed, value is NULL */
+	ROUTER_DELTA_REMOVED,
+	/* reply to router_call, signal is the method, not routed */
+	ROUTER_DELTA_REPLY,
+};
+
+/*
+ * A property of a ROUTER_DELTA_CHANGED record, split from its a{sv} on
+ * the worker. A property that is itself an a{sv} is split further into
+ * an entry per field, with subkey set and key naming the property.
+ */
+struct router_property {
+	/* interned */
+	const gchar *key;
+	/* interned, NULL for a property that is not an a{sv} */
+	const gchar *subkey;
+	GVariant *value;
+};
+
+struct router_delta {
+	enum router_delta_kind kind;
+	/* interned, compare by pointer or with strcmp */
+	const gchar *name;
+	const gchar *signal;
+	const gchar *property;
+	gchar *path;
+	/* object the record is about, NULL for ROUTER_DELTA_PROPERTY */
+	gchar *object;
+	GVariant *value;
+	/* value split on the worker, ROUTER_DELTA_CHANGED only */
+	struct router_property *properties;
+	guint n_properties;
+	/* last record decoded from the signal */
+	gboolean last;
+};
+
+typedef void (*router_cb)(const struct router_delta *delta,
+			  gpointer user_data);
+/* reply is owned by the router, error is set instead when the call failed */
+typedef void (*router_reply_cb)(GVariant *reply, const GError *error,
+				gpointer user_data);
+
+struct router;
+struct trace;
+
+struct router *router_new(GDBusConnection *connection);
+void router_free(struct router *router);
+GDBusConnection *router_get_connection(struct router *router);
+void router_set_trace(struct router *router, struct trace *trace);
+void router_subscribe(struct router *router, const gchar *name);
+void router_unsubscribe(struct router *router, const gchar *name);
+void router_add(struct router *router, const gchar *name, const gchar *path,
+		router_cb cb, gpointer user_data);
+void router_remove(struct router *router, const gchar *name,
+		   const gchar *path);
+void router_call(struct router *router, const gchar *name, const gchar *path,
+		 const gchar *interface, const gchar *method,
+		 GVariant *parameters, GCancellable *cancellable,
+		 router_reply_cb cb, gpointer user_data);
+void router_drain_totals(guint64 *batches, guint64 *deltas, gint64 *time);
+void router_stall_totals(guint64 *count, gint64 *time);
+guint router_match_rule_count(void);
+
+#endif /* _CONNMAN_GTK_ROUTER_H */
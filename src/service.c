@@ -26,82 +26,321 @@
 
 #include "config.h"
 #include "dialog.h"
-#include "status.h"
+#include "interfaces.h"
+#include "probes.h"
+#include "redraw.h"
 #include "style.h"
 #include "service.h"
 #include "settings.h"
+#include "stats.h"
 #include "util.h"
 #include "vpn.h"
 #include "wireless.h"
 
-static void update_name(struct service *serv)
+static const gchar *bus_name(struct service *serv)
 {
+	if(serv->type == CONNECTION_TYPE_VPN)
+		return CONNMAN_VPN_PATH;
+	return CONNMAN_PATH;
+}
+
+static const gchar *interface_name(struct service *serv)
+{
+	if(serv->type == CONNECTION_TYPE_VPN)
+		return VPN_CONNECTION_NAME;
+	return SERVICE_NAME;
+}
+
+/* Call a method on the service object directly, there is no proxy */
+static GVariant *service_call_sync(struct service *serv, const gchar *method,
+				   GVariant *parameters, GError **error)
+{
+	return g_dbus_connection_call_sync(serv->connection, bus_name(serv),
+					   serv->path, interface_name(serv),
+					   method, parameters, NULL,
+					   G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+					   error);
+}
+
+static void update_name(gpointer user_data)
+{
+	struct service *serv = user_data;
 	enum connection_type type = serv->type;
-	gchar *name, *state, *state_r, *title, *error;
+	const gchar *state = service_state_localized(serv->state);
+	gchar *name, *title;
 	name = service_get_property_string(serv, "Name", NULL);
-	state = service_get_property_string(serv, "State", NULL);
-	state_r = service_get_property_string_raw(serv, "State", NULL);
-	if(!strcmp(state_r, "failure")) {
-		const gchar *failure;
-		error = service_get_property_string(serv, "Error", NULL);
-		failure = failure_localized(error);
+	if(serv->state == SERVICE_STATE_FAILURE) {
+		const gchar *failure = service_error_localized(serv);
 		if(strlen(failure))
 			title = g_strdup_printf("%s - %s: %s", name,
 						state, failure);
 		else
 			title = g_strdup_printf("%s - %s", name, state);
-		g_free(error);
 	}
-	else if(type == CONNECTION_TYPE_WIRELESS && !strcmp(state_r, "idle"))
+	else if(type == CONNECTION_TYPE_WIRELESS &&
+		serv->state == SERVICE_STATE_IDLE)
 		title = g_strdup_printf("%s", name);
 	else
 		title = g_strdup_printf("%s - %s", name, state);
 	gtk_label_set_text(GTK_LABEL(serv->title), title);
 	g_free(name);
-	g_free(state);
-	g_free(state_r);
 	g_free(title);
 }
 
-static void set_label(struct service *serv, GtkWidget *label,
-		      const gchar *key, const gchar *subkey)
+/* A label of the row showing one property as it is */
+struct row_label {
+	struct service *serv;
+	GtkWidget *label;
+	const gchar *key;
+	const gchar *subkey;
+};
+
+static void update_label(gpointer user_data)
 {
-	gchar *value = service_get_property_string_raw(serv, key, subkey);
-	gtk_label_set_text(GTK_LABEL(label), value);
+	struct row_label *row = user_data;
+	gchar *value;
+
+	value = service_get_property_string_raw(row->serv, row->key,
+						row->subkey);
+	gtk_label_set_text(GTK_LABEL(row->label), value);
 	g_free(value);
 }
 
+static void bind_label(struct service *serv, GtkWidget *label,
+		       const gchar *key, const gchar *subkey)
+{
+	struct row_label *row = g_malloc(sizeof(*row));
+	struct binding *binding;
+
+	row->serv = serv;
+	row->label = label;
+	row->key = key;
+	row->subkey = subkey;
+	binding = binding_add(serv->bindings, update_label, row, g_free);
+	binding_depend(serv->bindings, binding, key, subkey);
+}
+
 void service_update_property_value(struct service *serv, const gchar *key,
 				   const gchar *subkey, GVariant *value)
 {
 	hash_table_set_dual_key(serv->properties, key, subkey,
 				g_variant_ref(value));
+	if(serv->bindings)
+		binding_set_changed(serv->bindings, key, subkey);
 	if(serv->sett)
-		settings_update(serv->sett, key, subkey, value);
+		settings_changed(serv->sett, key, subkey);
 }
 
-void service_update_property(struct service *serv, const gchar *key,
-                             GVariant *value)
+/* Redraw what the properties changed since the last redraw show */
+void service_redraw(struct service *serv)
 {
-	if(!strcmp(g_variant_get_type_string(value), "a{sv}")) {
-		gchar *subkey;
-		GVariantIter *iter = g_variant_iter_new(value);
-		while(g_variant_iter_loop(iter, "{sv}", &subkey, &value))
-			service_update_property_value(serv, key, subkey, value);
-		g_variant_iter_free(iter);
-	} else
-		service_update_property_value(serv, key, NULL, value);
+	if(serv->bindings)
+		binding_set_flush(serv->bindings);
+	if(serv->sett)
+		settings_update(serv->sett);
+}
 
-	update_name(serv);
+static const gchar *state_names[SERVICE_STATE_COUNT] = {
+	[SERVICE_STATE_UNKNOWN] = "",
+	[SERVICE_STATE_IDLE] = "idle",
+	[SERVICE_STATE_FAILURE] = "failure",
+	[SERVICE_STATE_ASSOCIATION] = "association",
+	[SERVICE_STATE_CONFIGURATION] = "configuration",
+	[SERVICE_STATE_READY] = "ready",
+	[SERVICE_STATE_DISCONNECT] = "disconnect",
+	[SERVICE_STATE_ONLINE] = "online",
+};
+
+static const gchar *error_names[SERVICE_ERROR_OTHER] = {
+	[SERVICE_ERROR_NONE] = "",
+	[SERVICE_ERROR_OUT_OF_RANGE] = "out-of-range",
+	[SERVICE_ERROR_PIN_MISSING] = "pin-missing",
+	[SERVICE_ERROR_DHCP_FAILED] = "dhcp-failed",
+	[SERVICE_ERROR_CONNECT_FAILED] = "connect-failed",
+	[SERVICE_ERROR_LOGIN_FAILED] = "login-failed",
+	[SERVICE_ERROR_AUTH_FAILED] = "auth-failed",
+	[SERVICE_ERROR_INVALID_KEY] = "invalid-key",
+};
+
+enum service_state service_state_from_string(const gchar *str)
+{
+	enum service_state state;
 
-	if(serv->type == CONNECTION_TYPE_WIRELESS)
+	for(state = SERVICE_STATE_IDLE; state < SERVICE_STATE_COUNT; state++)
+		if(!strcmp(str, state_names[state]))
+			return state;
+	return SERVICE_STATE_UNKNOWN;
+}
+
+const gchar *service_state_name(enum service_state state)
+{
+	if(state >= SERVICE_STATE_COUNT)
+		return "";
+	return state_names[state];
+}
+
+const gchar *service_state_localized(enum service_state state)
+{
+	switch(state) {
+	case SERVICE_STATE_IDLE:
+		return _("Idle");
+	case SERVICE_STATE_FAILURE:
+		return _("Failure");
+	case SERVICE_STATE_ASSOCIATION:
+		return _("Association");
+	case SERVICE_STATE_CONFIGURATION:
+		return _("Configuration");
+	case SERVICE_STATE_READY:
+		return _("Ready");
+	case SERVICE_STATE_DISCONNECT:
+		return _("Disconnected");
+	case SERVICE_STATE_ONLINE:
+		return _("Online");
+	case SERVICE_STATE_UNKNOWN:
+	case SERVICE_STATE_COUNT:
+		break;
+	}
+	return _("Error");
+}
+
+static enum service_error error_from_string(const gchar *str)
+{
+	enum service_error error;
+
+	for(error = SERVICE_ERROR_NONE; error < SERVICE_ERROR_OTHER; error++)
+		if(!strcmp(str, error_names[error]))
+			return error;
+	return SERVICE_ERROR_OTHER;
+}
+
+/* Errors this does not know are shown as ConnMan sent them */
+const gchar *service_error_localized(struct service *serv)
+{
+	GVariant *error;
+
+	switch(serv->error) {
+	case SERVICE_ERROR_NONE:
+		return "";
+	case SERVICE_ERROR_OUT_OF_RANGE:
+		return _("Out of range");
+	case SERVICE_ERROR_PIN_MISSING:
+		return _("PIN missing");
+	case SERVICE_ERROR_DHCP_FAILED:
+		return _("DHCP failed");
+	case SERVICE_ERROR_CONNECT_FAILED:
+		return _("Connecting failed");
+	case SERVICE_ERROR_LOGIN_FAILED:
+		return _("Login failed");
+	case SERVICE_ERROR_AUTH_FAILED:
+		return _("Authentication failed");
+	case SERVICE_ERROR_INVALID_KEY:
+		return _("Invalid key");
+	case SERVICE_ERROR_OTHER:
+	case SERVICE_ERROR_COUNT:
+		break;
+	}
+	error = hash_table_get_dual_key(serv->properties, "Error", NULL);
+	if(!error)
+		return "";
+	return g_variant_get_string(error, NULL);
+}
+
+static enum service_security security_from_variant(GVariant *value)
+{
+	enum service_security security = SERVICE_SECURITY_NONE;
+	const gchar **methods, **cur;
+
+	methods = g_variant_get_strv(value, NULL);
+	for(cur = methods; *cur; cur++) {
+		if(!strcmp("ieee8021x", *cur)) {
+			security = SERVICE_SECURITY_IEEE8021X;
+			break;
+		}
+		if(!strcmp("psk", *cur))
+			security = SERVICE_SECURITY_PSK;
+		else if(security < SERVICE_SECURITY_PSK && !strcmp("wps", *cur))
+			security = SERVICE_SECURITY_WPS;
+	}
+	g_free(methods);
+	return security;
+}
+
+static void set_flag(struct service *serv, guint flag, GVariant *value)
+{
+	if(variant_to_bool(value))
+		serv->flags |= flag;
+	else
+		serv->flags &= ~flag;
+}
+
+/*
+ * Whoever started it, a connect attempt is leaving a disconnected state
+ * for association or configuration, and a failure is entering failure
+ */
+static void track_state(struct service *serv, enum service_state state)
+{
+	if(state == serv->state)
 		return;
 
-	set_label(serv, serv->ipv4, "IPv4", "Address");
-	set_label(serv, serv->ipv4gateway, "IPv4", "Gateway");
-	set_label(serv, serv->ipv6, "IPv6", "Address");
-	set_label(serv, serv->ipv6gateway, "IPv6", "Gateway");
-	set_label(serv, serv->mac, "Ethernet", "Address");
+	serv->state_since = g_get_monotonic_time();
+	if(state == SERVICE_STATE_FAILURE)
+		serv->connect_failures++;
+	else if(SERVICE_STATE_DISCONNECTED(serv->state) &&
+		(state == SERVICE_STATE_ASSOCIATION ||
+		 state == SERVICE_STATE_CONFIGURATION))
+		serv->connect_attempts++;
+	serv->state = state;
+}
+
+static void decode_property(struct service *serv, const gchar *key,
+			    GVariant *value)
+{
+	if(!strcmp(key, "State"))
+		track_state(serv, service_state_from_string(
+					g_variant_get_string(value, NULL)));
+	else if(!strcmp(key, "Error"))
+		serv->error = error_from_string(g_variant_get_string(value,
+								     NULL));
+	else if(!strcmp(key, "Strength"))
+		serv->strength = variant_to_int(value);
+	else if(!strcmp(key, "Security"))
+		serv->security = security_from_variant(value);
+	else if(!strcmp(key, "Favorite"))
+		set_flag(serv, SERVICE_FAVORITE, value);
+	else if(!strcmp(key, "AutoConnect"))
+		set_flag(serv, SERVICE_AUTOCONNECT, value);
+	else if(!strcmp(key, "Immutable"))
+		set_flag(serv, SERVICE_IMMUTABLE, value);
+}
+
+static void store_property(struct service *serv, const gchar *key,
+			   GVariant *value)
+{
+	PROBE_PROPERTY_UPDATED(serv->path, key);
+	decode_property(serv, key, value);
+	if(g_variant_is_of_type(value, G_VARIANT_TYPE_VARDICT)) {
+		const gchar *subkey;
+		GVariant *subvalue;
+		GVariantIter iter;
+
+		g_variant_iter_init(&iter, value);
+		while(g_variant_iter_next(&iter, "{&sv}", &subkey, &subvalue)) {
+			service_update_property_value(serv, key, subkey,
+						      subvalue);
+			g_variant_unref(subvalue);
+		}
+	} else
+		service_update_property_value(serv, key, NULL, value);
+}
+
+void service_update_property(struct service *serv, const gchar *key,
+                             GVariant *value)
+{
+	gint64 start = stats_begin();
+
+	store_property(serv, key, value);
+	redraw_service(serv);
+	stats_end(STATS_SERVICE_UPDATE_PROPERTY, start);
 }
 
 static void show_field(GtkWidget *entry)
@@ -124,11 +363,11 @@ static void hide_field(GtkWidget *entry)
 	gtk_widget_hide(label);
 }
 
-static void update_fields(struct service *serv)
+static void update_fields(gpointer user_data)
 {
-	gchar *state = service_get_property_string_raw(serv, "State", NULL);
-	if(!strcmp(state, "idle") || !strcmp(state, "failure") ||
-	   !strcmp(state, "disconnect")) {
+	struct service *serv = user_data;
+
+	if(SERVICE_STATE_DISCONNECTED(serv->state)) {
 		hide_field(serv->ipv4);
 		hide_field(serv->ipv4gateway);
 		hide_field(serv->ipv6);
@@ -142,98 +381,135 @@ static void update_fields(struct service *serv)
 		show_field(serv->ipv6gateway);
 		show_field(serv->mac);
 	}
-	g_free(state);
 }
 
 void service_update(struct service *serv, GVariant *properties)
 {
-	GVariantIter *iter;
-	gchar *key;
+	gint64 start = stats_begin();
+	GVariantIter iter;
+	const gchar *key;
 	GVariant *value;
 
-	iter = g_variant_iter_new(properties);
-	while(g_variant_iter_loop(iter, "{sv}", &key, &value))
-		service_update_property(serv, key, value);
-	g_variant_iter_free(iter);
-	update_name(serv);
+	g_variant_iter_init(&iter, properties);
+	while(g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+		store_property(serv, key, value);
+		g_variant_unref(value);
+	}
+	redraw_service(serv);
+	stats_end(STATS_SERVICE_UPDATE, start);
+}
 
-	technology_service_updated(serv->tech, serv);
+/* service_update for properties the router has already split */
+void service_update_fields(struct service *serv,
+			   const struct router_property *properties,
+			   guint count)
+{
+	gint64 start = stats_begin();
+	guint i;
 
-	if(serv->type != CONNECTION_TYPE_WIRELESS) {
-		update_fields(serv);
-		return;
-	}
+	for(i = 0; i < count; i++) {
+		const struct router_property *property = &properties[i];
 
-	service_wireless_update(serv);
+		if(!property->subkey)
+			decode_property(serv, property->key, property->value);
+		service_update_property_value(serv, property->key,
+					      property->subkey,
+					      property->value);
+	}
+	redraw_service(serv);
+	stats_end(STATS_SERVICE_UPDATE, start);
 }
 
-static void ensure_field(GVariantDict *dict, const gchar *field,
-			 GVariant *value)
+/* Fields the settings pages expect even when ConnMan leaves them out */
+struct missing_field {
+	const gchar *group;
+	const gchar *field;
+	const gchar *string;
+	guint16 number;
+};
+
+static const struct missing_field missing_fields[] = {
+	{ "Ethernet", "Method", "auto", 0 },
+	{ "Ethernet", "Interface", "", 0 },
+	{ "Ethernet", "Address", "", 0 },
+	{ "Ethernet", "MTU", NULL, 1500 },
+	{ "IPv4", "Method", "off", 0 },
+	{ "IPv4", "Address", "", 0 },
+	{ "IPv4", "Netmask", "", 0 },
+	{ "IPv4", "Gateway", "", 0 },
+	{ "IPv6", "Method", "off", 0 },
+	{ "IPv6", "Address", "", 0 },
+	{ "IPv6", "PrefixLength", "", 0 },
+	{ "IPv6", "Gateway", "", 0 },
+};
+
+static gboolean has_field(GVariant *dict, const gchar *field)
 {
-	if(g_variant_dict_contains(dict, field)) {
-		g_variant_unref(value);
-		return;
-	}
-	g_variant_dict_insert_value(dict, field, value);
+	GVariant *value = g_variant_lookup_value(dict, field, NULL);
+
+	if(!value)
+		return FALSE;
+	g_variant_unref(value);
+	return TRUE;
 }
 
+/*
+ * The dictionary is looked into where it lies, and only rebuilt when a
+ * field is really missing, by appending the defaults to its entries
+ */
 static GVariant *add_missing_fields(const gchar *name, GVariant *value)
 {
-	GVariantDict *dict;
-
-	if(strcmp(name, "Ethernet") && strncmp(name, "IPv", 3) &&
-			strncmp(name, "Proxy", 5))
+	const struct missing_field *field;
+	GVariantBuilder builder;
+	gboolean missing = FALSE;
+	GVariantIter iter;
+	GVariant *entry;
+	guint i;
+
+	for(i = 0; i < G_N_ELEMENTS(missing_fields) && !missing; i++) {
+		field = &missing_fields[i];
+		missing = !strcmp(name, field->group) &&
+			  !has_field(value, field->field);
+	}
+	if(!missing)
 		return value;
 
-	dict = g_variant_dict_new(value);
-	if(!strcmp(name, "Ethernet")) {
-		ensure_field(dict, "Method", g_variant_new("s", "auto"));
-		ensure_field(dict, "Interface", g_variant_new("s", ""));
-		ensure_field(dict, "Address", g_variant_new("s", ""));
-		ensure_field(dict, "MTU", g_variant_new("q", 1500));
-	} else if(!strcmp(name, "IPv4")) {
-		ensure_field(dict, "Method", g_variant_new("s", "off"));
-		ensure_field(dict, "Address", g_variant_new("s", ""));
-		ensure_field(dict, "Netmask", g_variant_new("s", ""));
-		ensure_field(dict, "Gateway", g_variant_new("s", ""));
-	} else if(!strcmp(name, "IPv6")) {
-		ensure_field(dict, "Method", g_variant_new("s", "off"));
-		ensure_field(dict, "Address", g_variant_new("s", ""));
-		ensure_field(dict, "PrefixLength", g_variant_new("s", ""));
-		ensure_field(dict, "Gateway", g_variant_new("s", ""));
+	g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_iter_init(&iter, value);
+	while((entry = g_variant_iter_next_value(&iter))) {
+		g_variant_builder_add_value(&builder, entry);
+		g_variant_unref(entry);
+	}
+	for(i = 0; i < G_N_ELEMENTS(missing_fields); i++) {
+		field = &missing_fields[i];
+		if(strcmp(name, field->group) || has_field(value, field->field))
+			continue;
+		if(field->string)
+			g_variant_builder_add(&builder, "{sv}", field->field,
+					      g_variant_new_string(field->string));
+		else
+			g_variant_builder_add(&builder, "{sv}", field->field,
+					      g_variant_new_uint16(field->number));
 	}
 
 	g_variant_unref(value);
-	value = g_variant_dict_end(dict);
-	g_variant_dict_unref(dict);
-	return value;
+	return g_variant_ref_sink(g_variant_builder_end(&builder));
 }
 
-static void service_proxy_signal(GDBusProxy *proxy, gchar *sender,
-                                 gchar *signal, GVariant *parameters,
-                                 gpointer user_data)
+static void service_signal(const struct router_delta *delta,
+			   gpointer user_data)
 {
 	struct service *serv = user_data;
-	if(!strcmp(signal, "PropertyChanged")) {
-		GVariant *name_v, *value_v, *value;
-		const gchar *name;
-
-		name_v = g_variant_get_child_value(parameters, 0);
-		value_v = g_variant_get_child_value(parameters, 1);
-
-		name = g_variant_get_string(name_v, NULL);
-		value = g_variant_get_child_value(value_v, 0);
-		value = add_missing_fields(name, value);
+	if(delta->kind == ROUTER_DELTA_PROPERTY) {
+		const gchar *name = delta->property;
+		GVariant *value;
 
+		value = add_missing_fields(name, g_variant_ref(delta->value));
 		service_update_property(serv, name, value);
 		g_variant_unref(value);
-		g_variant_unref(name_v);
-		g_variant_unref(value_v);
-
-		technology_service_updated(serv->tech, serv);
 
 		if(!strcmp(name, "State"))
-			status_update();
+			redraw_status();
 	}
 }
 
@@ -241,7 +517,8 @@ static void settings_closed(struct service *serv)
 {
 	if(serv) {
 		serv->sett = NULL;
-		gtk_widget_set_sensitive(serv->settings_button, TRUE);
+		if(serv->settings_button)
+			gtk_widget_set_sensitive(serv->settings_button, TRUE);
 	}
 }
 
@@ -276,15 +553,73 @@ static GtkWidget *add_label(GtkWidget *grid, gint y, const gchar *text)
 	return value;
 }
 
-void service_init(struct service *serv, GDBusProxy *proxy, const gchar *path,
-                  GVariant *properties)
+void service_init(struct service *serv, struct router *router,
+                  const gchar *path, GVariant *properties)
 {
-	GtkGrid *item_grid;
+	static guint next_order;
 
-	serv->proxy = proxy;
-	serv->path = g_strdup(path);
+	serv->router = router;
+	serv->connection = g_object_ref(router_get_connection(router));
+	serv->path = path_intern(path);
 	serv->properties = dual_hash_table_new((GDestroyNotify)g_variant_unref);
+	serv->state = SERVICE_STATE_UNKNOWN;
+	serv->error = SERVICE_ERROR_NONE;
+	serv->security = SERVICE_SECURITY_NONE;
+	serv->strength = 0;
+	serv->flags = 0;
+	serv->order = next_order++;
+	serv->state_since = g_get_monotonic_time();
+	serv->connect_attempts = 0;
+	serv->connect_failures = 0;
 	serv->sett = NULL;
+	serv->bindings = NULL;
+	serv->item = NULL;
+	serv->header = NULL;
+	serv->title = NULL;
+	serv->contents = NULL;
+	serv->settings_button = NULL;
+	serv->data = NULL;
+
+	router_add(router, bus_name(serv), serv->path, service_signal, serv);
+}
+
+/* The title shows the name and the state, with the error on failure */
+static void bind_name(struct service *serv)
+{
+	struct binding *binding;
+
+	binding = binding_add(serv->bindings, update_name, serv, NULL);
+	binding_depend(serv->bindings, binding, "Name", NULL);
+	binding_depend(serv->bindings, binding, "State", NULL);
+	binding_depend(serv->bindings, binding, "Error", NULL);
+	if(serv->type == CONNECTION_TYPE_ETHERNET)
+		binding_depend(serv->bindings, binding, "Ethernet",
+			       "Interface");
+	else if(serv->type == CONNECTION_TYPE_WIRELESS)
+		binding_depend(serv->bindings, binding, "Security", NULL);
+}
+
+static void bind_wireless(struct service *serv)
+{
+	struct binding *binding;
+
+	binding = binding_add(serv->bindings,
+			      (binding_func)service_wireless_update, serv,
+			      NULL);
+	binding_depend(serv->bindings, binding, "Name", NULL);
+	binding_depend(serv->bindings, binding, "Security", NULL);
+	binding_depend(serv->bindings, binding, "Strength", NULL);
+	binding_depend(serv->bindings, binding, "Favorite", NULL);
+}
+
+/* Build the list row for the service and bind it to the properties */
+void service_ui_create(struct service *serv)
+{
+	struct binding *binding;
+	GtkGrid *item_grid;
+
+	if(serv->item)
+		return;
 
 	serv->item = gtk_list_box_row_new();
 	serv->header = gtk_grid_new();
@@ -301,8 +636,6 @@ void service_init(struct service *serv, GDBusProxy *proxy, const gchar *path,
 	g_object_ref(serv->contents);
 	g_object_set_data(G_OBJECT(serv->item), "service", serv);
 
-	g_signal_connect(proxy, "g-signal", G_CALLBACK(service_proxy_signal),
-	                 serv);
 	g_signal_connect(serv->settings_button, "clicked",
 	                 G_CALLBACK(settings_button_cb), serv);
 
@@ -327,8 +660,15 @@ void service_init(struct service *serv, GDBusProxy *proxy, const gchar *path,
 	gtk_grid_attach(item_grid, serv->header, 0, 0, 1, 1);
 	gtk_grid_attach(item_grid, serv->contents, 0, 1, 1, 1);
 	gtk_container_add(GTK_CONTAINER(serv->item), GTK_WIDGET(item_grid));
+	if(serv->sett)
+		gtk_widget_set_sensitive(serv->settings_button, FALSE);
+	serv->bindings = binding_set_new();
+	bind_name(serv);
 	if(serv->type == CONNECTION_TYPE_WIRELESS) {
 		gtk_widget_show_all(serv->item);
+		service_wireless_init(serv);
+		bind_wireless(serv);
+		binding_set_update_all(serv->bindings);
 		return;
 	}
 
@@ -339,34 +679,55 @@ void service_init(struct service *serv, GDBusProxy *proxy, const gchar *path,
 	if(serv->type != CONNECTION_TYPE_VPN)
 		serv->mac = add_label(serv->contents, 4, _("MAC address"));
 	else
-		serv->mac = gtk_label_new(NULL);
+		serv->mac = g_object_ref_sink(gtk_label_new(NULL));
 
 	gtk_widget_show_all(serv->item);
+
+	bind_label(serv, serv->ipv4, "IPv4", "Address");
+	bind_label(serv, serv->ipv4gateway, "IPv4", "Gateway");
+	bind_label(serv, serv->ipv6, "IPv6", "Address");
+	bind_label(serv, serv->ipv6gateway, "IPv6", "Gateway");
+	bind_label(serv, serv->mac, "Ethernet", "Address");
+	binding = binding_add(serv->bindings, update_fields, serv, NULL);
+	binding_depend(serv->bindings, binding, "State", NULL);
+	binding_set_update_all(serv->bindings);
 }
 
-struct service *service_create(struct technology *tech, GDBusProxy *proxy,
+void service_ui_free(struct service *serv)
+{
+	if(!serv->item)
+		return;
+
+	binding_set_free(serv->bindings);
+	serv->bindings = NULL;
+	if(serv->type == CONNECTION_TYPE_WIRELESS)
+		service_wireless_free(serv);
+	else if(serv->type == CONNECTION_TYPE_VPN)
+		g_object_unref(serv->mac);
+	gtk_widget_destroy(serv->item);
+	g_object_unref(serv->item);
+	g_object_unref(serv->contents);
+	g_object_unref(serv->header);
+	g_object_unref(serv->title);
+	serv->item = NULL;
+	serv->header = NULL;
+	serv->title = NULL;
+	serv->contents = NULL;
+	serv->settings_button = NULL;
+	serv->data = NULL;
+}
+
+struct service *service_create(struct technology *tech, struct router *router,
                                const gchar *path, GVariant *properties)
 {
 	struct service *serv;
-	enum connection_type type;
-	GVariantDict *properties_d;
-	GVariant *type_v;
-
-	properties_d = g_variant_dict_new(properties);
-	type_v = g_variant_dict_lookup_value(properties_d, "Type", NULL);
-	type = connection_type_from_string(g_variant_get_string(type_v, NULL));
-	g_variant_unref(type_v);
-	g_variant_dict_unref(properties_d);
 
 	serv = g_malloc(sizeof(*serv));
-	serv->type = type;
+	serv->type = connection_type_from_properties(properties);
 	serv->tech = tech;
 	serv->sett = NULL;
 
-	service_init(serv, proxy, path, properties);
-	if(serv->type == CONNECTION_TYPE_WIRELESS)
-		service_wireless_init(serv, proxy, path, properties);
-
+	service_init(serv, router, path, properties);
 	service_update(serv, properties);
 
 	return serv;
@@ -380,37 +741,22 @@ void service_free(struct service *serv)
 		serv->sett->serv = NULL;
 		gtk_window_close(GTK_WINDOW(serv->sett->window));
 	}
-	g_object_unref(serv->proxy);
-	g_free(serv->path);
+	service_ui_free(serv);
+	redraw_forget_service(serv);
+	router_remove(serv->router, bus_name(serv), serv->path);
+	g_object_unref(serv->connection);
+	path_unref(serv->path);
 	dual_hash_table_unref(serv->properties);
-	gtk_widget_destroy(serv->item);
-	g_object_unref(serv->item);
-	g_object_unref(serv->contents);
-	g_object_unref(serv->header);
-	if(serv->type == CONNECTION_TYPE_WIRELESS)
-		service_wireless_free(serv);
 	g_free(serv);
 }
 
-static gboolean strv_contains(const gchar *const *strv, const gchar *str) {
-	const gchar *const *iter = strv;
-	while(*iter && strcmp(*iter, str))
-		iter++;
-	return *iter != NULL;
-}
-
 static void show_wireless_error(struct service *serv, const gchar *message)
 {
 	const gchar *e;
-	gchar **security;
 
 	e = _("IEEE8021x secured services have to be manually configured.");
-	security = service_get_property_strv(serv, "Security", NULL);
-
-	if(strv_contains((const gchar **)security, "ieee8021x"))
+	if(serv->security == SERVICE_SECURITY_IEEE8021X)
 		show_error(_("Failed to toggle connection state."), e);
-
-	g_strfreev(security);
 }
 
 static void service_toggle_connection_cb(GObject *source, GAsyncResult *res,
@@ -426,7 +772,8 @@ static void service_toggle_connection_cb(GObject *source, GAsyncResult *res,
 	GVariant *out;
 
 	serv = user_data;
-	out = g_dbus_proxy_call_finish(serv->proxy, res, &error);
+	out = g_dbus_connection_call_finish(serv->connection, res, &error);
+	PROBE_CALL_END(serv->path, error ? error->message : "");
 	if(error) {
 		/*
 		 * InvalidArguments is thrown when user cancels the dialog,
@@ -455,20 +802,18 @@ static void service_toggle_connection_cb(GObject *source, GAsyncResult *res,
 void service_toggle_connection(struct service *serv)
 {
 	const gchar *function;
-	gchar *state;
-
-	state = service_get_property_string_raw(serv, "State", NULL);
 
-	if(!strcmp(state, "idle") || !strcmp(state, "failure"))
+	if(serv->state == SERVICE_STATE_IDLE ||
+	   serv->state == SERVICE_STATE_FAILURE)
 		function = "Connect";
 	else
 		function = "Disconnect";
 
-	g_free(state);
-
-	g_dbus_proxy_call(serv->proxy, function, NULL,
-	                  G_DBUS_CALL_FLAGS_NONE, CONNECTION_TIMEOUT, NULL,
-	                  service_toggle_connection_cb, serv);
+	PROBE_CALL_BEGIN(serv->path, function);
+	g_dbus_connection_call(serv->connection, bus_name(serv), serv->path,
+			       interface_name(serv), function, NULL, NULL,
+			       G_DBUS_CALL_FLAGS_NONE, CONNECTION_TIMEOUT, NULL,
+			       service_toggle_connection_cb, serv);
 }
 
 GVariant *service_get_property(struct service *serv, const char *key,
@@ -497,29 +842,22 @@ gchar *service_get_property_string_raw(struct service *serv, const char *key,
 
 static gchar *wireless_name(struct service *serv)
 {
-	gchar *name, **security, **iter;
+	enum service_security security = serv->security;
 	const gchar *out;
-	int security_level = 0;
+	gchar *name;
 
 	name = service_get_property_string_raw(serv, "Name", NULL);
 	if(strlen(name))
 		return name;
 	g_free(name);
 
-	security = service_get_property_strv(serv, "Security", NULL);
-	for(iter = security; *iter; iter++) {
-		if(!strcmp("ieee8021x", *iter))
-			security_level = 3;
-		else if(security_level < 2 && !strcmp("psk", *iter))
-			security_level = 2;
-		else if(security_level < 1 && !strcmp("wps", *iter))
-			security_level = 1;
-	}
-	out = (security_level == 3 ? _("Hidden ieee8021x secured network") :
-	       security_level == 2 ? _("Hidden WPA secured network") :
-	       security_level == 1 ? _("Hidden WPS secured network") :
+	out = (security == SERVICE_SECURITY_IEEE8021X ?
+	       _("Hidden ieee8021x secured network") :
+	       security == SERVICE_SECURITY_PSK ?
+	       _("Hidden WPA secured network") :
+	       security == SERVICE_SECURITY_WPS ?
+	       _("Hidden WPS secured network") :
 	       _("Hidden unsecured network"));
-	g_strfreev(security);
 	return g_strdup(out);
 }
 
@@ -554,18 +892,11 @@ gchar *service_get_property_string(struct service *serv, const char *key,
 
 	if(key) {
 		if(!strcmp(key, "AutoConnect")) {
-			gboolean ac;
-
-			ac = service_get_property_boolean(serv, key, subkey);
-			if(ac)
+			if(serv->flags & SERVICE_AUTOCONNECT)
 				return g_strdup(_("On"));
 			return g_strdup(_("Off"));
 		} else if(!strcmp(key, "State")) {
-			gchar *str = service_get_property_string_raw(serv, key,
-								     subkey);
-			gchar *out = g_strdup(status_localized(str));
-			g_free(str);
-			return out;
+			return g_strdup(service_state_localized(serv->state));
 		} else if(serv->type == CONNECTION_TYPE_ETHERNET &&
 			  !strcmp(key, "Name")) {
 			return service_get_property_string_raw(serv, "Ethernet",
@@ -648,8 +979,9 @@ void service_set_property(struct service *serv, const char *key,
 		return;
 
 	parameters = g_variant_new("(sv)", key, value);
-	ret = g_dbus_proxy_call_sync(serv->proxy, "SetProperty", parameters,
-	                             G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+	PROBE_CALL_BEGIN(serv->path, "SetProperty");
+	ret = service_call_sync(serv, "SetProperty", parameters, &error);
+	PROBE_CALL_END(serv->path, error ? error->message : "");
 	if(error) {
 		g_warning("failed to set property %s: %s", key, error->message);
 		g_error_free(error);
@@ -709,8 +1041,7 @@ void service_remove(struct service *serv)
 	GVariant *ret;
 	GError *error = NULL;
 
-	ret = g_dbus_proxy_call_sync(serv->proxy, "Remove", NULL,
-	                             G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+	ret = service_call_sync(serv, "Remove", NULL, &error);
 	if(error) {
 		g_warning("failed to remove service: %s", error->message);
 		g_error_free(error);
@@ -25,20 +25,84 @@
 #include <gio/gio.h>
 #include <glib.h>
 
+#include "binding.h"
 #include "connection.h"
+#include "router.h"
 #include "technology.h"
 #include "settings.h"
 #include "util.h"
 
 #define CONNECTION_TIMEOUT (120 * 1000)
 
+enum service_state {
+	SERVICE_STATE_UNKNOWN,
+	SERVICE_STATE_IDLE,
+	SERVICE_STATE_FAILURE,
+	SERVICE_STATE_ASSOCIATION,
+	SERVICE_STATE_CONFIGURATION,
+	SERVICE_STATE_READY,
+	SERVICE_STATE_DISCONNECT,
+	SERVICE_STATE_ONLINE,
+	SERVICE_STATE_COUNT
+};
+
+/* SERVICE_ERROR_OTHER is anything ConnMan added later, see "Error" */
+enum service_error {
+	SERVICE_ERROR_NONE,
+	SERVICE_ERROR_OUT_OF_RANGE,
+	SERVICE_ERROR_PIN_MISSING,
+	SERVICE_ERROR_DHCP_FAILED,
+	SERVICE_ERROR_CONNECT_FAILED,
+	SERVICE_ERROR_LOGIN_FAILED,
+	SERVICE_ERROR_AUTH_FAILED,
+	SERVICE_ERROR_INVALID_KEY,
+	SERVICE_ERROR_OTHER,
+	SERVICE_ERROR_COUNT
+};
+
+/* The strongest method in "Security", in increasing order */
+enum service_security {
+	SERVICE_SECURITY_NONE,
+	SERVICE_SECURITY_WPS,
+	SERVICE_SECURITY_PSK,
+	SERVICE_SECURITY_IEEE8021X
+};
+
+#define SERVICE_FAVORITE (1 << 0)
+#define SERVICE_AUTOCONNECT (1 << 1)
+#define SERVICE_IMMUTABLE (1 << 2)
+
+#define SERVICE_STATE_DISCONNECTED(state) \
+        ((state) == SERVICE_STATE_IDLE || (state) == SERVICE_STATE_FAILURE || \
+        (state) == SERVICE_STATE_DISCONNECT)
+
 struct service {
 	enum connection_type type;
 	struct technology *tech;
 	struct settings *sett;
-	GDBusProxy *proxy;
-	gchar *path;
+	/* only set while the row exists, like the widgets */
+	struct binding_set *bindings;
+	struct router *router;
+	GDBusConnection *connection;
+	const gchar *path;
+	/*
+	 * The properties read on every update are decoded once when they
+	 * arrive, the rest are only kept in properties
+	 */
+	enum service_state state;
+	enum service_error error;
+	enum service_security security;
+	gint strength;
+	guint flags;
 	DualHashTable *properties;
+	guint order;
+
+	/* since when State has had its value, and how it has changed */
+	gint64 state_since;
+	guint connect_attempts;
+	guint connect_failures;
+
+	/* the widgets are only set while the main window exists */
 	GtkWidget *item;
 	GtkWidget *header;
 	GtkWidget *title;
@@ -59,14 +123,25 @@ struct service {
         (strength) > 5 ? ("network-" type "-signal-weak-symbolic") : \
         ("network-" type "-signal-none-symbolic"))
 
-struct service *service_create(struct technology *tech, GDBusProxy *proxy,
+struct service *service_create(struct technology *tech, struct router *router,
                                const gchar *path, GVariant *properties);
-void service_init(struct service *serv, GDBusProxy *proxy, const gchar *path,
-                  GVariant *properties);
+void service_init(struct service *serv, struct router *router,
+                  const gchar *path, GVariant *properties);
 void service_update(struct service *serv, GVariant *properties);
+void service_update_fields(struct service *serv,
+			   const struct router_property *properties,
+			   guint count);
+void service_redraw(struct service *serv);
+void service_ui_create(struct service *serv);
+void service_ui_free(struct service *serv);
 void service_free(struct service *serv);
 void service_toggle_connection(struct service *serv);
 
+enum service_state service_state_from_string(const gchar *str);
+const gchar *service_state_name(enum service_state state);
+const gchar *service_state_localized(enum service_state state);
+const gchar *service_error_localized(struct service *serv);
+
 GVariant *service_get_property(struct service *serv, const char *key,
                                const char *subkey);
 gchar *service_get_property_string_raw(struct service *serv, const char *key,
@@ -24,9 +24,11 @@
 
 #include "config.h"
 #include "connection.h"
+#include "frame_monitor.h"
 #include "service.h"
 #include "settings.h"
 #include "settings_content.h"
+#include "stats.h"
 #include "style.h"
 #include "util.h"
 
@@ -120,7 +122,7 @@ static struct settings_page *add_page_to_combo_box(struct settings *sett,
 static void free_settings(struct settings *sett)
 {
 	sett->closed(sett->serv);
-	dual_hash_table_unref(sett->callbacks);
+	binding_set_free(sett->bindings);
 	dual_hash_table_unref(sett->contents);
 	g_free(sett);
 }
@@ -597,8 +599,7 @@ static void add_clear_page(struct settings *sett)
 
 static void add_pages(struct settings *sett)
 {
-	gboolean immutable = service_get_property_boolean(sett->serv,
-							  "Immutable", NULL);
+	gboolean immutable = sett->serv->flags & SERVICE_IMMUTABLE;
 	if(immutable || sett->serv->type == CONNECTION_TYPE_VPN) {
 		gchar *type;
 
@@ -691,6 +692,7 @@ static void init_settings(struct settings *sett)
 	gtk_window_set_title(GTK_WINDOW(sett->window), title);
 	gtk_window_set_default_size(GTK_WINDOW(sett->window), SETTINGS_WIDTH,
 	                            SETTINGS_HEIGHT);
+	frame_monitor_attach(sett->window, "settings");
 
 	g_free(title);
 	g_free(name);
@@ -747,7 +749,7 @@ struct settings *settings_create(struct service *serv,
 
 	sett->serv = serv;
 	sett->closed = closed;
-	sett->callbacks = dual_hash_table_new(content_callback_free);
+	sett->bindings = binding_set_new();
 	sett->contents = dual_hash_table_new(NULL);
 
 	init_settings(sett);
@@ -755,19 +757,44 @@ struct settings *settings_create(struct service *serv,
 	return sett;
 }
 
-void settings_update(struct settings *sett, const gchar *key,
-                     const gchar *subkey, GVariant *value)
+void settings_changed(struct settings *sett, const gchar *key,
+                      const gchar *subkey)
 {
-	struct content_callback *cb;
+	binding_set_changed(sett->bindings, key, subkey);
+}
+
+/* Redraw the contents whose properties changed since the last update */
+void settings_update(struct settings *sett)
+{
+	gint64 start = stats_begin();
 
-	cb = hash_table_get_dual_key(sett->callbacks, key, subkey);
-	if(cb)
-		handle_content_callback(value, key, subkey, cb);
+	binding_set_flush(sett->bindings);
+	stats_end(STATS_SETTINGS_UPDATE, start);
+}
+
+static void update_content(gpointer user_data)
+{
+	struct content_callback *cb = user_data;
+	GVariant *value;
+
+	if(!cb->sett->serv)
+		return;
+	value = hash_table_get_dual_key(cb->sett->serv->properties, cb->key,
+					cb->subkey);
+	if(value)
+		handle_content_callback(value, cb->key, cb->subkey, cb);
 }
 
 void settings_set_callback(struct settings *sett, const gchar *key,
                            const gchar *subkey, struct content_callback *cb)
 {
-	hash_table_set_dual_key(sett->callbacks, key, subkey, cb);
+	struct binding *binding;
+
+	cb->sett = sett;
+	cb->key = g_intern_string(key);
+	cb->subkey = subkey ? g_intern_string(subkey) : NULL;
+	binding = binding_add(sett->bindings, update_content, cb,
+			      content_callback_free);
+	binding_depend(sett->bindings, binding, key, subkey);
 }
 
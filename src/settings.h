@@ -26,6 +26,7 @@
 struct settings;
 struct settings_page;
 
+#include "binding.h"
 #include "service.h"
 #include "settings_content.h"
 #include "util.h"
@@ -41,7 +42,7 @@ struct settings {
 	struct service *serv;
 	void (*closed)(struct service *serv);
 
-	DualHashTable *callbacks;
+	struct binding_set *bindings;
 	DualHashTable *contents;
 };
 
@@ -54,8 +55,9 @@ struct settings_page {
 
 struct settings *settings_create(struct service *serv,
                                  void (*closed)(struct service *serv));
-void settings_update(struct settings *sett, const gchar *key,
-                     const gchar *subkey, GVariant *value);
+void settings_changed(struct settings *sett, const gchar *key,
+                      const gchar *subkey);
+void settings_update(struct settings *sett);
 void settings_set_callback(struct settings *sett, const gchar *key,
                            const gchar *subkey, struct content_callback *cb);
 
@@ -24,6 +24,7 @@
 #include <string.h>
 
 #include "config.h"
+#include "service.h"
 #include "settings.h"
 #include "settings_content.h"
 #include "style.h"
@@ -945,6 +946,9 @@ struct content_callback *create_callback(GtkWidget *label,
 	struct content_callback *cb = g_malloc(sizeof(*cb));
 	cb->type = type;
 	cb->data = label;
+	cb->sett = NULL;
+	cb->key = NULL;
+	cb->subkey = NULL;
 	return cb;
 }
 
@@ -965,7 +969,8 @@ void handle_content_callback(GVariant *value, const gchar *key,
 			str = variant_to_str(value);
 		if(!strcmp(key, "State"))
 			gtk_label_set_text(GTK_LABEL(label),
-			                   status_localized(str));
+			                   service_state_localized(
+			                   service_state_from_string(str)));
 		else
 			gtk_label_set_text(GTK_LABEL(label), str);
 		g_free(str);
@@ -101,6 +101,10 @@ enum content_callback_type {
 struct content_callback {
 	enum content_callback_type type;
 	void *data;
+	/* the property shown, set when it is bound */
+	struct settings *sett;
+	const gchar *key;
+	const gchar *subkey;
 };
 
 struct content_callback *create_callback(GtkWidget *label,
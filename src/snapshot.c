@@ -0,0 +1,113 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "snapshot.h"
+
+/*
+ * The last known GetTechnologies and GetServices replies, stored as a
+ * serialized GVariant so that it can be mapped and used without parsing.
+ * Bump the version whenever the layout changes.
+ */
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_TYPE "(ua(oa{sv})a(oa{sv}))"
+
+static gchar *snapshot_dir(void)
+{
+	return g_build_filename(g_get_user_cache_dir(), "connman-gtk", NULL);
+}
+
+static gchar *snapshot_path(void)
+{
+	return g_build_filename(g_get_user_cache_dir(), "connman-gtk",
+				"snapshot", NULL);
+}
+
+gboolean snapshot_load(GVariant **technologies, GVariant **services)
+{
+	GError *error = NULL;
+	GMappedFile *file;
+	GVariant *data;
+	GBytes *bytes;
+	gchar *path;
+	guint32 version;
+
+	path = snapshot_path();
+	file = g_mapped_file_new(path, FALSE, &error);
+	if(error) {
+		if(!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_warning("Failed to open snapshot %s: %s", path,
+				  error->message);
+		g_error_free(error);
+		g_free(path);
+		return FALSE;
+	}
+	g_free(path);
+
+	/* the file is replaced atomically, so the mapping never changes */
+	bytes = g_mapped_file_get_bytes(file);
+	g_mapped_file_unref(file);
+	data = g_variant_new_from_bytes(G_VARIANT_TYPE(SNAPSHOT_TYPE), bytes,
+					FALSE);
+	g_bytes_unref(bytes);
+	g_variant_ref_sink(data);
+
+	g_variant_get(data, "(u@a(oa{sv})@a(oa{sv}))", &version,
+		      technologies, services);
+	g_variant_unref(data);
+
+	if(version != SNAPSHOT_VERSION) {
+		g_variant_unref(*technologies);
+		g_variant_unref(*services);
+		*technologies = NULL;
+		*services = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Consumes floating references */
+void snapshot_save(GVariant *technologies, GVariant *services)
+{
+	GError *error = NULL;
+	GVariant *data;
+	gchar *dir, *path;
+
+	data = g_variant_new("(u@a(oa{sv})@a(oa{sv}))", SNAPSHOT_VERSION,
+			     technologies, services);
+	g_variant_ref_sink(data);
+
+	dir = snapshot_dir();
+	path = snapshot_path();
+	if(g_mkdir_with_parents(dir, 0700))
+		g_warning("Failed to create %s", dir);
+	else if(!g_file_set_contents(path, g_variant_get_data(data),
+				     g_variant_get_size(data), &error)) {
+		g_warning("Failed to write snapshot %s: %s", path,
+			  error->message);
+		g_error_free(error);
+	}
+
+	g_free(dir);
+	g_free(path);
+	g_variant_unref(data);
+}
@@ -0,0 +1,202 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gtk/gtk.h>
+
+#include "stats.h"
+#include "style.h"
+
+/* Seconds between refreshes of the statistics window */
+#define STATS_REFRESH 1
+
+static const gchar *handler_names[STATS_HANDLER_COUNT] = {
+	[STATS_SERVICES_CHANGED] = "services_changed",
+	[STATS_SERVICE_UPDATE] = "service_update",
+	[STATS_SERVICE_UPDATE_PROPERTY] = "service_update_property",
+	[STATS_TECHNOLOGY_PROPERTY_CHANGED] = "technology_property_changed",
+	[STATS_STATUS_UPDATE] = "status_update",
+	[STATS_SETTINGS_UPDATE] = "settings_update",
+	[STATS_REDRAW_FLUSH] = "redraw_flush",
+	[STATS_AGENT_METHOD_CALL] = "agent method_call",
+};
+
+/* only the main thread runs the handlers, so no locking */
+static struct stats_entry entries[STATS_HANDLER_COUNT];
+
+static GtkWidget *window, *label;
+static guint refresh_id;
+
+void stats_end(enum stats_handler handler, gint64 start)
+{
+	struct stats_entry *entry = &entries[handler];
+	gint64 us = g_get_monotonic_time() - start;
+	guint bucket;
+
+	bucket = us > 0 ? g_bit_storage((gulong)us) : 0;
+	entry->buckets[MIN(bucket, STATS_BUCKETS - 1)]++;
+	entry->calls++;
+	entry->total += us;
+	entry->max = MAX(entry->max, us);
+}
+
+const struct stats_entry *stats_get(enum stats_handler handler)
+{
+	return &entries[handler];
+}
+
+const gchar *stats_handler_name(enum stats_handler handler)
+{
+	return handler_names[handler];
+}
+
+void stats_reset(void)
+{
+	memset(entries, 0, sizeof(entries));
+}
+
+/* Upper bound of the bucket the p'th percentile call fell in */
+static guint64 bucket_percentile(struct stats_entry *entry, guint p)
+{
+	guint64 rank = (entry->calls * p + 99) / 100, seen = 0;
+	guint i;
+
+	for(i = 0; i < STATS_BUCKETS - 1; i++) {
+		seen += entry->buckets[i];
+		if(seen >= rank)
+			return (guint64)1 << i;
+	}
+	return (guint64)entry->max;
+}
+
+gchar *stats_format(void)
+{
+	GString *str = g_string_new(NULL);
+	guint i, j;
+
+	g_string_append_printf(str, "%-28s %10s %10s %10s %10s %10s\n",
+			       "handler", "calls", "mean us", "p50 <us",
+			       "p99 <us", "max us");
+	for(i = 0; i < STATS_HANDLER_COUNT; i++) {
+		struct stats_entry *entry = &entries[i];
+
+		if(!entry->calls) {
+			g_string_append_printf(str, "%-28s %10d\n",
+					       handler_names[i], 0);
+			continue;
+		}
+		g_string_append_printf(str, "%-28s %10" G_GUINT64_FORMAT
+				       " %10.1f %10" G_GUINT64_FORMAT
+				       " %10" G_GUINT64_FORMAT
+				       " %10" G_GINT64_FORMAT "\n",
+				       handler_names[i], entry->calls,
+				       (gdouble)entry->total / entry->calls,
+				       bucket_percentile(entry, 50),
+				       bucket_percentile(entry, 99),
+				       entry->max);
+	}
+
+	g_string_append(str, "\ncalls under 2^n us\n");
+	for(i = 0; i < STATS_HANDLER_COUNT; i++) {
+		struct stats_entry *entry = &entries[i];
+
+		if(!entry->calls)
+			continue;
+		g_string_append_printf(str, "%s:", handler_names[i]);
+		for(j = 0; j < STATS_BUCKETS; j++)
+			if(entry->buckets[j])
+				g_string_append_printf(str, " %s%u:%"
+						       G_GUINT64_FORMAT,
+						       j == STATS_BUCKETS - 1 ?
+						       ">=" : "", j,
+						       entry->buckets[j]);
+		g_string_append_c(str, '\n');
+	}
+	return g_string_free(str, FALSE);
+}
+
+static gboolean refresh(gpointer user_data)
+{
+	gchar *text = stats_format();
+
+	gtk_label_set_text(GTK_LABEL(label), text);
+	g_free(text);
+	return G_SOURCE_CONTINUE;
+}
+
+static void reset_clicked(GtkButton *button, gpointer user_data)
+{
+	stats_reset();
+	refresh(NULL);
+}
+
+static void window_destroyed(GtkWidget *widget, gpointer user_data)
+{
+	g_source_remove(refresh_id);
+	refresh_id = 0;
+	window = NULL;
+	label = NULL;
+}
+
+/* Not reachable from the interface, only through the statistics action */
+void stats_window_show(void)
+{
+	GtkWidget *grid, *scrolled, *reset;
+
+	if(window) {
+		gtk_window_present(GTK_WINDOW(window));
+		return;
+	}
+
+	window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	gtk_window_set_title(GTK_WINDOW(window), _("Handler statistics"));
+	gtk_window_set_default_size(GTK_WINDOW(window), 760, 360);
+
+	grid = gtk_grid_new();
+	scrolled = gtk_scrolled_window_new(NULL, NULL);
+	label = gtk_label_new(NULL);
+	reset = gtk_button_new_with_mnemonic(_("_Reset"));
+
+	style_set_margin(grid, MARGIN_LARGE);
+	gtk_grid_set_row_spacing(GTK_GRID(grid), MARGIN_LARGE);
+	gtk_widget_set_hexpand(scrolled, TRUE);
+	gtk_widget_set_vexpand(scrolled, TRUE);
+	gtk_widget_set_halign(reset, GTK_ALIGN_END);
+	gtk_label_set_selectable(GTK_LABEL(label), TRUE);
+	gtk_label_set_xalign(GTK_LABEL(label), 0);
+	gtk_label_set_yalign(GTK_LABEL(label), 0);
+	gtk_style_context_add_class(gtk_widget_get_style_context(label),
+				    "monospace");
+
+	gtk_container_add(GTK_CONTAINER(scrolled), label);
+	gtk_grid_attach(GTK_GRID(grid), scrolled, 0, 0, 1, 1);
+	gtk_grid_attach(GTK_GRID(grid), reset, 0, 1, 1, 1);
+	gtk_container_add(GTK_CONTAINER(window), grid);
+
+	g_signal_connect(reset, "clicked", G_CALLBACK(reset_clicked), NULL);
+	g_signal_connect(window, "destroy", G_CALLBACK(window_destroyed),
+			 NULL);
+	refresh(NULL);
+	refresh_id = g_timeout_add_seconds(STATS_REFRESH, refresh, NULL);
+	gtk_widget_show_all(window);
+}
@@ -0,0 +1,66 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_STATS_H
+#define _CONNMAN_GTK_STATS_H
+
+#include <gtk/gtk.h>
+
+/*
+ * Call counts and latency histograms of the handlers on the hot path,
+ * always kept. Times are inclusive, service_update contains the
+ * service_update_property calls it makes and redraw_flush the
+ * status_update and settings_update ones.
+ */
+enum stats_handler {
+	STATS_SERVICES_CHANGED,
+	STATS_SERVICE_UPDATE,
+	STATS_SERVICE_UPDATE_PROPERTY,
+	STATS_TECHNOLOGY_PROPERTY_CHANGED,
+	STATS_STATUS_UPDATE,
+	STATS_SETTINGS_UPDATE,
+	STATS_REDRAW_FLUSH,
+	STATS_AGENT_METHOD_CALL,
+	STATS_HANDLER_COUNT
+};
+
+/* Bucket i counts calls under 2^i us, the last one everything longer */
+#define STATS_BUCKETS 24
+
+struct stats_entry {
+	guint64 calls;
+	gint64 total;
+	gint64 max;
+	guint64 buckets[STATS_BUCKETS];
+};
+
+static inline gint64 stats_begin(void)
+{
+	return g_get_monotonic_time();
+}
+
+void stats_end(enum stats_handler handler, gint64 start);
+const struct stats_entry *stats_get(enum stats_handler handler);
+const gchar *stats_handler_name(enum stats_handler handler);
+void stats_reset(void);
+gchar *stats_format(void);
+void stats_window_show(void);
+
+#endif /* _CONNMAN_GTK_STATS_H */
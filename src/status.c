@@ -24,9 +24,11 @@
 #include "config.h"
 #include "configurator.h"
 #include "connection.h"
+#include "host.h"
 #include "main.h"
 #include "status.h"
 #include "service.h"
+#include "stats.h"
 #include "technology.h"
 
 #ifdef USE_STATUS_ICON
@@ -39,7 +41,9 @@ static void status_activate(gpointer *ignored, gpointer user_data)
 
 static void status_exit(gpointer *ignored, gpointer user_data)
 {
-	g_signal_emit_by_name(main_window, "destroy");
+	if(main_window)
+		gtk_widget_destroy(main_window);
+	g_application_quit(user_data);
 }
 
 static void status_toggle_connection(gpointer *ignored, gpointer user_data)
@@ -49,15 +53,14 @@ static void status_toggle_connection(gpointer *ignored, gpointer user_data)
 
 static GtkWidget *create_service_item(struct service *serv)
 {
-	gchar *name, *state, *state_r, *label;
+	const gchar *state = service_state_localized(serv->state);
+	gchar *name, *label;
 	GtkWidget *item, *child;
 
 	name = service_get_property_string(serv, "Name", NULL);
-	state = service_get_property_string(serv, "State", NULL);
-	state_r = service_get_property_string_raw(serv, "State", NULL);
 
 	/* Todo: is autoupdate needed here? */
-	if(strcmp(state_r, "idle"))
+	if(serv->state != SERVICE_STATE_IDLE)
 		label = g_markup_printf_escaped("<b>%s - %s</b>", name, state);
 	else
 		label = g_markup_printf_escaped("%s - %s", name, state);
@@ -69,8 +72,6 @@ static GtkWidget *create_service_item(struct service *serv)
 			 serv);
 
 	g_free(name);
-	g_free(state);
-	g_free(state_r);
 	g_free(label);
 
 	return item;
@@ -102,7 +103,7 @@ static void status_menu(GtkStatusIcon *icon, guint button, guint activate_time,
 		GtkMenu *submenu;
 		gboolean has_items = FALSE;
 
-		tech = technologies[index];
+		tech = current_host->technologies[index];
 		if(!tech)
 			continue;
 		if(!technology_get_property_bool(tech, "Powered"))
@@ -133,41 +134,41 @@ static void status_menu(GtkStatusIcon *icon, guint button, guint activate_time,
 void status_update(void) {
 	int best_status = 0;
 	int index;
+	gint64 start;
 
 	if(!status_icon_enabled)
 		return;
 
+	start = stats_begin();
+
 	for(index = CONNECTION_TYPE_ETHERNET; index < CONNECTION_TYPE_COUNT; index++) {
 		struct technology *tech;
 		GHashTableIter iter;
 		gpointer key, service;
 
-		tech = technologies[index];
+		tech = current_host->technologies[index];
 		if(!tech)
 			continue;
 
 		g_hash_table_iter_init(&iter, tech->services);
 		while(g_hash_table_iter_next(&iter, &key, &service)) {
-			gchar *state;
-			state = service_get_property_string_raw(service, "State",
-			                                        NULL);
+			struct service *serv = service;
+
 			switch(best_status) {
 				case 0:
-					if(!strcmp(state, "association"))
+					if(serv->state == SERVICE_STATE_ASSOCIATION)
 						best_status = 1;
 				case 1:
-					if(!strcmp(state, "configuration"))
+					if(serv->state == SERVICE_STATE_CONFIGURATION)
 						best_status = 2;
 				case 2:
-					if(!strcmp(state, "ready"))
+					if(serv->state == SERVICE_STATE_READY)
 						best_status = 3;
 				case 3:
-					if(!strcmp(state, "online"))
+					if(serv->state == SERVICE_STATE_ONLINE)
 						best_status = 4;
 			}
 
-			g_free(state);
-
 			if(best_status == 4)
 				break;
 		}
@@ -186,6 +187,7 @@ void status_update(void) {
 			gtk_status_icon_set_from_icon_name(icon, "network-transmit-receive");
 			break;
 	}
+	stats_end(STATS_STATUS_UPDATE, start);
 }
 
 void status_init(GtkApplication *app)
@@ -41,6 +41,9 @@ void style_init()
 		      "  background-color: white;" \
 		      "  padding: 5px;" \
 		      "}" \
+		      ".cm-stale {" \
+		      "  opacity: 0.6;" \
+		      "}" \
 		      "";
 
 	css_provider = gtk_css_provider_new();
@@ -77,6 +80,18 @@ void style_add_context(GtkWidget *widget)
 				       GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
 }
 
+/* Dim widgets which show data from the snapshot and not from ConnMan */
+void style_set_stale(GtkWidget *widget, gboolean stale)
+{
+	GtkStyleContext *context = gtk_widget_get_style_context(widget);
+
+	style_add_context(widget);
+	if(stale)
+		gtk_style_context_add_class(context, "cm-stale");
+	else
+		gtk_style_context_remove_class(context, "cm-stale");
+}
+
 void style_set_margin(GtkWidget *widget, gint margin)
 {
 	style_set_margin_start(widget, margin);
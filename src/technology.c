@@ -29,7 +29,11 @@
 #include "config.h"
 #include "connection.h"
 #include "dialog.h"
+#include "interfaces.h"
 #include "main.h"
+#include "probes.h"
+#include "redraw.h"
+#include "stats.h"
 #include "status.h"
 #include "style.h"
 #include "technology.h"
@@ -105,6 +109,9 @@ static void update_status(struct technology *tech)
 	gboolean connected, powered, tethering;
 	const gchar *name;
 
+	if(!tech->settings)
+		return;
+
 	if(tech->type == CONNECTION_TYPE_VPN) {
 		vpn_update_status(tech);
 		return;
@@ -150,31 +157,28 @@ static void update_status(struct technology *tech)
 static void update_power(struct technology *tech)
 {
 	struct technology_settings *item = tech->settings;
+	gboolean powered;
+
+	if(!item)
+		return;
 
-	gboolean powered = technology_get_property_bool(tech, "Powered");
+	powered = technology_get_property_bool(tech, "Powered");
 	g_signal_handler_block(G_OBJECT(item->power_switch), item->powersig);
 	gtk_switch_set_active(GTK_SWITCH(item->power_switch), powered);
 	g_signal_handler_unblock(G_OBJECT(item->power_switch), item->powersig);
 	update_status(tech);
 }
 
-static void handle_proxy_signal(GDBusProxy *proxy, gchar *sender,
-                                gchar *signal, GVariant *parameters,
-                                gpointer user_data)
+static void handle_signal(const struct router_delta *delta,
+			  gpointer user_data)
 {
 	struct technology *tech = user_data;
-	if(!strcmp(signal, "PropertyChanged")) {
-		GVariant *name_v, *value_v, *value;
-		gchar *name;
-		name_v = g_variant_get_child_value(parameters, 0);
-		value_v = g_variant_get_child_value(parameters, 1);
-		value = g_variant_get_child_value(value_v, 0);
-		name = g_variant_dup_string(name_v, NULL);
-		g_hash_table_replace(tech->settings->properties, name, value);
-		technology_property_changed(tech, name);
+	if(delta->kind == ROUTER_DELTA_PROPERTY) {
+		const gchar *name = g_intern_string(delta->property);
 
-		g_variant_unref(name_v);
-		g_variant_unref(value_v);
+		g_hash_table_replace(tech->properties, (gpointer)name,
+				     g_variant_ref(delta->value));
+		technology_property_changed(tech, name);
 	}
 }
 
@@ -214,9 +218,14 @@ static void tether_button_cb(GtkButton *widget, gpointer user_data)
 
 static void update_tethering(struct technology *tech)
 {
+	gboolean state;
+	GtkButton *button;
 
-	gboolean state = technology_get_property_bool(tech, "Tethering");
-	GtkButton *button = GTK_BUTTON(tech->settings->tethering);
+	if(!tech->settings)
+		return;
+
+	state = technology_get_property_bool(tech, "Tethering");
+	button = GTK_BUTTON(tech->settings->tethering);
 	if(state)
 		gtk_button_set_label(button, _("Disable _tethering"));
 	else
@@ -227,9 +236,11 @@ static void update_connect_button(struct technology *tech)
 {
 	struct technology_settings *item;
 	const gchar *button_state;
-	gchar *state;
+	enum service_state state;
 
 	item = tech->settings;
+	if(!item)
+		return;
 
 	if(!item->selected) {
 		if(!shutting_down)
@@ -238,19 +249,17 @@ static void update_connect_button(struct technology *tech)
 		return;
 	}
 
-	state = service_get_property_string_raw(item->selected, "State", NULL);
+	state = item->selected->state;
 
 	gtk_widget_set_sensitive(item->connect_button, TRUE);
 	gtk_widget_set_can_focus(item->connect_button, TRUE);
-	if(!strcmp(state, "idle") || !strcmp(state, "disconnect"))
+	if(state == SERVICE_STATE_IDLE || state == SERVICE_STATE_DISCONNECT)
 		button_state = _("_Connect");
-	else if(!strcmp(state, "failure"))
+	else if(state == SERVICE_STATE_FAILURE)
 		button_state = _("Re_connect");
 	else
 		button_state = _("Dis_connect");
 	gtk_button_set_label(GTK_BUTTON(item->connect_button), button_state);
-
-	g_free(state);
 }
 
 static void service_selected(GtkListBox *box, GtkListBoxRow *row,
@@ -270,33 +279,14 @@ void service_evented(GtkWidget *widget, GdkEvent *event, gpointer user_data)
 		connect_button_cb(NULL, user_data);
 }
 
-struct technology_settings *technology_create_settings(struct technology *tech,
-                GVariant *properties, GDBusProxy *proxy)
+struct technology_settings *technology_create_settings(struct technology *tech)
 {
 	struct technology_settings *item = g_malloc(sizeof(*item));
-
-	GVariantIter *iter;
-	gchar *key;
-	GVariant *value;
 	GtkWidget *powerbox, *frame, *scrolled_window, *eventbox;
 
 	item->technology = tech;
-	item->properties = g_hash_table_new_full(g_str_hash, g_str_equal,
-	                   g_free, (GDestroyNotify)g_variant_unref);
 	item->selected = NULL;
 
-	iter = g_variant_iter_new(properties);
-	while(g_variant_iter_loop(iter, "{sv}", &key, &value)) {
-		gchar *hkey = g_strdup(key);
-		g_variant_ref(value);
-		g_hash_table_insert(item->properties, hkey, value);
-	}
-	g_variant_iter_free(iter);
-
-	item->proxy = proxy;
-	g_signal_connect(proxy, "g-signal", G_CALLBACK(handle_proxy_signal),
-	                 tech);
-
 	item->grid = gtk_grid_new();
 	item->icon = gtk_image_new();
 	item->title = gtk_label_new(NULL);
@@ -419,31 +409,77 @@ void free_technology_settings(struct technology_settings *item)
 	g_object_unref(item->grid);
 	gtk_widget_destroy(item->grid);
 
-	g_object_unref(item->proxy);
-	g_hash_table_unref(item->properties);
-
 	g_free(item);
 }
 
+/* The page is redrawn once per frame however many properties change */
 void technology_property_changed(struct technology *tech, const gchar *key)
 {
-	update_power(tech);
-	update_status(tech);
-	update_tethering(tech);
+	gint64 start = stats_begin();
+
+	tech->properties_dirty = TRUE;
+	redraw_technology(tech);
+	stats_end(STATS_TECHNOLOGY_PROPERTY_CHANGED, start);
 }
 
-void technology_add_service(struct technology *tech, struct service *serv)
+/* Nothing is called on a technology ConnMan has not confirmed */
+void technology_set_stale(struct technology *tech, gboolean stale)
+{
+	tech->stale = stale;
+	if(tech->type == CONNECTION_TYPE_WIRELESS)
+		technology_wireless_update_scan(tech);
+}
+
+void technology_update(struct technology *tech, GVariant *properties)
 {
+	GVariantIter iter;
+	const gchar *key;
+	GVariant *value;
+
+	g_variant_iter_init(&iter, properties);
+	while(g_variant_iter_next(&iter, "{&sv}", &key, &value))
+		g_hash_table_replace(tech->properties,
+				     (gpointer)g_intern_string(key), value);
+	technology_property_changed(tech, NULL);
+}
+
+static void attach_service(struct technology *tech, struct service *serv)
+{
+	service_ui_create(serv);
 	gtk_container_add(GTK_CONTAINER(tech->settings->services), serv->item);
-	g_hash_table_insert(tech->services, g_strdup(serv->path), serv);
+}
+
+void technology_add_service(struct technology *tech, struct service *serv)
+{
+	g_hash_table_insert(tech->services, (gpointer)path_intern(serv->path),
+			    serv);
+	if(tech->settings)
+		attach_service(tech, serv);
 
 	if(tech->type == CONNECTION_TYPE_VPN)
-		vpn_update_status(tech);
+		redraw_technology(tech);
 }
 
+/* The connect button follows the selected service, the VPN page all */
 void technology_service_updated(struct technology *tech, struct service *serv)
 {
-	if(tech->settings->selected == serv)
+	if(!tech)
+		return;
+
+	if((tech->settings && tech->settings->selected == serv) ||
+	   tech->type == CONNECTION_TYPE_VPN)
+		redraw_technology(tech);
+}
+
+void technology_redraw(struct technology *tech)
+{
+	if(tech->properties_dirty) {
+		tech->properties_dirty = FALSE;
+		update_power(tech);
+		update_tethering(tech);
+	}
+
+	if(tech->settings && tech->settings->selected)
 		update_connect_button(tech);
 
 	if(tech->type == CONNECTION_TYPE_VPN)
@@ -452,7 +488,8 @@ void technology_service_updated(struct technology *tech, struct service *serv)
 
 void technology_remove_service(struct technology *tech, const gchar *path)
 {
-	if(tech->settings->selected == g_hash_table_lookup(tech->services,
+	if(tech->settings &&
+	   tech->settings->selected == g_hash_table_lookup(tech->services,
 							   path)) {
 		tech->settings->selected = NULL;
 		update_connect_button(tech);
@@ -460,47 +497,64 @@ void technology_remove_service(struct technology *tech, const gchar *path)
 	g_hash_table_remove(tech->services, path);
 
 	if(tech->type == CONNECTION_TYPE_VPN)
-		vpn_update_status(tech);
+		redraw_technology(tech);
+}
+
+/* The services outlive it, until ConnMan says otherwise */
+static void detach_services(struct technology *tech)
+{
+	GHashTableIter iter;
+	gpointer serv;
+
+	g_hash_table_iter_init(&iter, tech->services);
+	while(g_hash_table_iter_next(&iter, NULL, &serv))
+		((struct service *)serv)->tech = NULL;
 }
 
 void technology_free(struct technology *item)
 {
 	if(!item)
 		return;
-	free_list_item(item->list_item);
-	free_technology_settings(item->settings);
+	technology_ui_free(item);
+	detach_services(item);
+	redraw_forget_technology(item);
+	router_remove(item->router, CONNMAN_PATH, item->path);
+	g_object_unref(item->connection);
+	g_hash_table_unref(item->properties);
 	g_hash_table_unref(item->services);
-	g_free(item->path);
+	path_unref(item->path);
 	if(item->type == CONNECTION_TYPE_WIRELESS)
 		technology_wireless_free(item);
 	g_free(item);
 }
 
 void technology_init(struct technology *tech, GVariant *properties_v,
-                     GDBusProxy *proxy)
+                     struct router *router)
 {
-	GVariant *type_v;
-	const gchar *type;
-	GVariantDict *properties;
-
-	properties = g_variant_dict_new(properties_v);
-	type_v = g_variant_dict_lookup_value(properties, "Type", NULL);
-	type = g_variant_get_string(type_v, NULL);
-	g_variant_dict_unref(properties);
+	GVariantIter iter;
+	const gchar *key;
+	GVariant *value;
 
-	tech->type = connection_type_from_string(type);
+	tech->type = connection_type_from_properties(properties_v);
 	tech->services = g_hash_table_new_full(g_str_hash, g_str_equal,
-	                                       g_free, NULL);
-	tech->settings = technology_create_settings(tech, properties_v,
-	                 proxy);
-	tech->list_item = technology_create_item(tech);
-
-	update_connect_button(tech);
-	update_status(tech);
-	update_power(tech);
-	update_tethering(tech);
-
-	g_variant_unref(type_v);
+	                                       (GDestroyNotify)path_unref,
+	                                       NULL);
+	/* the names are interned, like those of the services */
+	tech->properties = g_hash_table_new_full(g_str_hash, g_str_equal,
+	                   NULL, (GDestroyNotify)g_variant_unref);
+	tech->list_item = NULL;
+	tech->settings = NULL;
+	tech->stale = FALSE;
+	tech->properties_dirty = FALSE;
+
+	g_variant_iter_init(&iter, properties_v);
+	while(g_variant_iter_next(&iter, "{&sv}", &key, &value))
+		g_hash_table_insert(tech->properties,
+				    (gpointer)g_intern_string(key), value);
+
+	tech->router = router;
+	tech->connection = g_object_ref(router_get_connection(router));
+	router_add(router, CONNMAN_PATH, tech->path, handle_signal, tech);
 }
 
 static void set_icons(struct technology *tech)
@@ -545,44 +599,84 @@ static void set_icons(struct technology *tech)
 
 }
 
-struct technology *technology_create(GDBusProxy *proxy, const gchar *path,
-                                     GVariant *properties)
+struct technology *technology_create(struct router *router,
+                                     const gchar *path, GVariant *properties)
 {
 	struct technology *item;
-	GVariantDict *properties_d;
-	GVariant *type_v;
-	enum connection_type type;
-
-	properties_d = g_variant_dict_new(properties);
-	type_v = g_variant_dict_lookup_value(properties_d, "Type", NULL);
-	type = connection_type_from_string(g_variant_get_string(type_v, NULL));
-	g_variant_unref(type_v);
-	g_variant_dict_unref(properties_d);
 
 	item = g_malloc(sizeof(*item));
-	item->type = type;
-	item->path = g_strdup(path);
+	item->path = path_intern(path);
+
+	technology_init(item, properties, router);
+	if(item->type == CONNECTION_TYPE_WIRELESS)
+		technology_wireless_init(item, properties);
 
-	technology_init(item, properties, proxy);
-	set_icons(item);
-	if(type == CONNECTION_TYPE_WIRELESS)
-		technology_wireless_init(item, properties, proxy);
+	return item;
+}
+
+static gint compare_service_order(gconstpointer a, gconstpointer b)
+{
+	const struct service *first = a, *second = b;
+	return (first->order > second->order) - (first->order < second->order);
+}
+
+/* Build the notebook page and list row, including the service rows */
+void technology_ui_create(struct technology *tech)
+{
+	GList *values, *l;
+
+	if(tech->settings)
+		return;
+
+	tech->settings = technology_create_settings(tech);
+	tech->list_item = technology_create_item(tech);
+	set_icons(tech);
 
 	/* XXX: hack to fix window width with variable text length */
-	gtk_button_set_label(GTK_BUTTON(item->settings->connect_button),
+	gtk_button_set_label(GTK_BUTTON(tech->settings->connect_button),
 			     _("Re_connect"));
-	gtk_button_set_label(GTK_BUTTON(item->settings->connect_button),
+	gtk_button_set_label(GTK_BUTTON(tech->settings->connect_button),
 			     _("Dis_connect"));
-	gtk_button_set_label(GTK_BUTTON(item->settings->connect_button),
+	gtk_button_set_label(GTK_BUTTON(tech->settings->connect_button),
 			     _("_Connect"));
-	update_connect_button(item);
 
-	return item;
+	values = g_hash_table_get_values(tech->services);
+	values = g_list_sort(values, compare_service_order);
+	for(l = values; l; l = l->next)
+		attach_service(tech, l->data);
+	g_list_free(values);
+
+	update_connect_button(tech);
+	update_status(tech);
+	update_power(tech);
+	update_tethering(tech);
+	if(tech->type == CONNECTION_TYPE_WIRELESS)
+		technology_wireless_update_scan(tech);
+}
+
+void technology_ui_free(struct technology *tech)
+{
+	GHashTableIter iter;
+	gpointer key, serv;
+
+	if(!tech->settings)
+		return;
+
+	g_hash_table_iter_init(&iter, tech->services);
+	while(g_hash_table_iter_next(&iter, &key, &serv))
+		service_ui_free(serv);
+
+	free_list_item(tech->list_item);
+	free_technology_settings(tech->settings);
+	tech->list_item = NULL;
+	tech->settings = NULL;
+	if(tech->type == CONNECTION_TYPE_WIRELESS)
+		technology_wireless_update_scan(tech);
 }
 
 GVariant *technology_get_property(struct technology *tech, const gchar *key)
 {
-	return g_hash_table_lookup(tech->settings->properties, key);
+	return g_hash_table_lookup(tech->properties, key);
 }
 
 const gchar *technology_get_property_string(struct technology *tech,
@@ -608,9 +702,14 @@ void technology_set_property(struct technology *tech, const gchar *key,
 	GVariant *ret;
 	GError *error = NULL;
 
-	ret = g_dbus_proxy_call_sync(tech->settings->proxy, "SetProperty",
-	                             g_variant_new("(sv)", key, value),
-	                             G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+	PROBE_CALL_BEGIN(tech->path, "SetProperty");
+	ret = g_dbus_connection_call_sync(tech->connection,
+					  CONNMAN_PATH, tech->path,
+					  TECHNOLOGY_NAME, "SetProperty",
+					  g_variant_new("(sv)", key, value),
+					  NULL, G_DBUS_CALL_FLAGS_NONE, -1,
+					  NULL, &error);
+	PROBE_CALL_END(tech->path, error ? error->message : "");
 	if(error) {
 		g_warning("failed to set technology property %s: %s",
 		          key, error->message);
@@ -624,3 +723,13 @@ void technology_set_property(struct technology *tech, const gchar *key,
 	}
 	g_variant_unref(ret);
 }
+
+void technology_call(struct technology *tech, const gchar *method,
+                     GVariant *parameters, GAsyncReadyCallback callback,
+                     gpointer user_data)
+{
+	g_dbus_connection_call(tech->connection, CONNMAN_PATH,
+			       tech->path, TECHNOLOGY_NAME, method, parameters,
+			       NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+			       callback, user_data);
+}
@@ -26,6 +26,7 @@
 #include <gtk/gtk.h>
 
 #include "connection.h"
+#include "router.h"
 #include "service.h"
 
 struct technology;
@@ -42,9 +43,6 @@ struct technology_list_item {
 struct technology_settings {
 	struct technology *technology;
 	struct service *selected;
-	GHashTable *properties;
-
-	GDBusProxy *proxy;
 
 	GtkWidget *grid;
 
@@ -63,23 +61,36 @@ struct technology_settings {
 	GtkWidget *connect_button;
 };
 
+/* list_item and settings are only set while the main window exists */
 struct technology {
 	struct technology_list_item *list_item;
 	struct technology_settings *settings;
 	GHashTable *services;
-	gchar *path;
+	GHashTable *properties;
+	struct router *router;
+	GDBusConnection *connection;
+	const gchar *path;
 	enum connection_type type;
+	/* only known from the snapshot, or kept while ConnMan is away */
+	gboolean stale;
+	/* properties changed since the page was last redrawn */
+	gboolean properties_dirty;
 	void *data;
 };
 
-struct technology *technology_create(GDBusProxy *proxy, const gchar *path,
-                                     GVariant *properties);
+struct technology *technology_create(struct router *router,
+                                     const gchar *path, GVariant *properties);
 void technology_init(struct technology *tech, GVariant *properties_v,
-                     GDBusProxy *proxy);
+                     struct router *router);
+void technology_ui_create(struct technology *tech);
+void technology_ui_free(struct technology *tech);
+void technology_update(struct technology *item, GVariant *properties);
 void technology_property_changed(struct technology *item, const gchar *key);
+void technology_set_stale(struct technology *item, gboolean stale);
 void technology_services_updated(struct technology *item);
 void technology_add_service(struct technology *item, struct service *serv);
 void technology_service_updated(struct technology *item, struct service *serv);
+void technology_redraw(struct technology *item);
 void technology_remove_service(struct technology *item, const gchar *path);
 GVariant *technology_get_property(struct technology *item, const gchar *key);
 const gchar *technology_get_property_string(struct technology *item,
@@ -88,6 +99,9 @@ gboolean technology_get_property_bool(struct technology *item,
 				      const gchar *key);
 void technology_set_property(struct technology *item, const gchar *key,
                              GVariant *value);
+void technology_call(struct technology *item, const gchar *method,
+                     GVariant *parameters, GAsyncReadyCallback callback,
+                     gpointer user_data);
 void technology_free(struct technology *item);
 
 #endif /* _CONNMAN_GTK_TECHNOLOGY_H */
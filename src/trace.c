@@ -0,0 +1,244 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "trace.h"
+
+#define TRACE_MAGIC "CMGTKTRC"
+#define TRACE_VERSION 1
+/* A record holds one D-Bus body, which is at most 128 MiB, and its names */
+#define TRACE_RECORD_MAX (128 * 1024 * 1024 + 64 * 1024)
+
+/* Written from the router threads and the main thread */
+struct trace {
+	GMutex lock;
+	GOutputStream *stream;
+	gint64 start;
+};
+
+struct trace_reader {
+	GInputStream *stream;
+};
+
+static void trace_fail(struct trace *trace, GError *error)
+{
+	g_warning("Stopped recording the trace: %s", error->message);
+	g_error_free(error);
+	g_clear_object(&trace->stream);
+}
+
+struct trace *trace_new(const gchar *filename)
+{
+	GFileOutputStream *out;
+	GZlibCompressor *compressor;
+	struct trace *trace;
+	GError *error = NULL;
+	GFile *file;
+	guint32 version = GUINT32_TO_LE(TRACE_VERSION);
+
+	file = g_file_new_for_path(filename);
+	out = g_file_replace(file, NULL, FALSE,
+			     G_FILE_CREATE_REPLACE_DESTINATION, NULL, &error);
+	g_object_unref(file);
+	if(!out) {
+		g_warning("Failed to open trace %s: %s", filename,
+			  error->message);
+		g_error_free(error);
+		return NULL;
+	}
+
+	trace = g_malloc0(sizeof(*trace));
+	g_mutex_init(&trace->lock);
+	compressor = g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+	trace->stream = g_converter_output_stream_new(G_OUTPUT_STREAM(out),
+						    G_CONVERTER(compressor));
+	g_object_unref(compressor);
+	g_object_unref(out);
+	trace->start = g_get_monotonic_time();
+
+	if(!g_output_stream_write_all(trace->stream, TRACE_MAGIC,
+				      strlen(TRACE_MAGIC), NULL, NULL,
+				      &error) ||
+	   !g_output_stream_write_all(trace->stream, &version,
+				      sizeof(version), NULL, NULL, &error))
+		trace_fail(trace, error);
+	return trace;
+}
+
+void trace_write(struct trace *trace, enum trace_kind kind,
+		 const gchar *name, const gchar *path, const gchar *interface,
+		 const gchar *member, GVariant *body)
+{
+	GVariant *record;
+	GError *error = NULL;
+	guint32 size;
+
+	if(!trace)
+		return;
+
+	record = g_variant_new(TRACE_RECORD_TYPE, (guchar)kind,
+			       (guint64)(g_get_monotonic_time() - trace->start),
+			       name, path, interface, member, body);
+	g_variant_ref_sink(record);
+	if(G_BYTE_ORDER == G_BIG_ENDIAN) {
+		GVariant *swapped = g_variant_byteswap(record);
+
+		g_variant_unref(record);
+		record = swapped;
+	}
+	size = GUINT32_TO_LE((guint32)g_variant_get_size(record));
+
+	g_mutex_lock(&trace->lock);
+	if(trace->stream &&
+	   (!g_output_stream_write_all(trace->stream, &size, sizeof(size),
+				       NULL, NULL, &error) ||
+	    !g_output_stream_write_all(trace->stream,
+				       g_variant_get_data(record),
+				       g_variant_get_size(record), NULL, NULL,
+				       &error)))
+		trace_fail(trace, error);
+	g_mutex_unlock(&trace->lock);
+
+	g_variant_unref(record);
+}
+
+/* Records written after closing are dropped, the trace itself stays */
+void trace_close(struct trace *trace)
+{
+	if(!trace)
+		return;
+
+	g_mutex_lock(&trace->lock);
+	if(trace->stream)
+		g_output_stream_close(trace->stream, NULL, NULL);
+	g_clear_object(&trace->stream);
+	g_mutex_unlock(&trace->lock);
+}
+
+/* Only once nothing can write to it any more */
+void trace_free(struct trace *trace)
+{
+	if(!trace)
+		return;
+
+	trace_close(trace);
+	g_mutex_clear(&trace->lock);
+	g_free(trace);
+}
+
+struct trace_reader *trace_reader_new(const gchar *filename, GError **error)
+{
+	GZlibDecompressor *decompressor;
+	struct trace_reader *reader;
+	GFileInputStream *in;
+	gchar magic[sizeof(TRACE_MAGIC) - 1];
+	guint32 version;
+	gsize read;
+	GFile *file;
+
+	file = g_file_new_for_path(filename);
+	in = g_file_read(file, NULL, error);
+	g_object_unref(file);
+	if(!in)
+		return NULL;
+
+	reader = g_malloc(sizeof(*reader));
+	decompressor = g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+	reader->stream = g_converter_input_stream_new(G_INPUT_STREAM(in),
+						G_CONVERTER(decompressor));
+	g_object_unref(decompressor);
+	g_object_unref(in);
+
+	if(!g_input_stream_read_all(reader->stream, magic, sizeof(magic),
+				    &read, NULL, error) ||
+	   !g_input_stream_read_all(reader->stream, &version,
+				    sizeof(version), &read, NULL, error))
+		goto fail;
+	if(memcmp(magic, TRACE_MAGIC, sizeof(magic)) ||
+	   GUINT32_FROM_LE(version) != TRACE_VERSION) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			    "%s is not a version %d trace", filename,
+			    TRACE_VERSION);
+		goto fail;
+	}
+	return reader;
+
+fail:
+	trace_reader_free(reader);
+	return NULL;
+}
+
+/* Returns NULL at the end of the trace or on error */
+GVariant *trace_reader_next(struct trace_reader *reader, GError **error)
+{
+	GVariant *record;
+	guint32 size;
+	gsize read;
+	gchar *data;
+
+	if(!g_input_stream_read_all(reader->stream, &size, sizeof(size),
+				    &read, NULL, error) || !read)
+		return NULL;
+	if(read != sizeof(size)) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+			    "Truncated trace");
+		return NULL;
+	}
+
+	size = GUINT32_FROM_LE(size);
+	if(size > TRACE_RECORD_MAX) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			    "Corrupt trace, record of %u bytes", size);
+		return NULL;
+	}
+	data = g_malloc(size);
+	if(!g_input_stream_read_all(reader->stream, data, size, &read, NULL,
+				    error) || read != size) {
+		if(error && !*error)
+			g_set_error(error, G_IO_ERROR,
+				    G_IO_ERROR_PARTIAL_INPUT,
+				    "Truncated trace");
+		g_free(data);
+		return NULL;
+	}
+
+	record = g_variant_new_from_data(G_VARIANT_TYPE(TRACE_RECORD_TYPE),
+					 data, size, FALSE, g_free, data);
+	g_variant_ref_sink(record);
+	if(G_BYTE_ORDER == G_BIG_ENDIAN) {
+		GVariant *swapped = g_variant_byteswap(record);
+
+		g_variant_unref(record);
+		record = swapped;
+	}
+	return record;
+}
+
+void trace_reader_free(struct trace_reader *reader)
+{
+	if(!reader)
+		return;
+	g_object_unref(reader->stream);
+	g_free(reader);
+}
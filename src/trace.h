@@ -0,0 +1,57 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_TRACE_H
+#define _CONNMAN_GTK_TRACE_H
+
+#include <gio/gio.h>
+#include <glib.h>
+
+/*
+ * Gzip compressed trace of the D-Bus traffic from ConnMan. After an eight
+ * byte magic and a little endian 32 bit version, every record is a little
+ * endian 32 bit length followed by a little endian serialized GVariant of
+ * TRACE_RECORD_TYPE: kind, microseconds since the trace was opened, bus
+ * name, object path, interface, member and the body.
+ */
+
+#define TRACE_RECORD_TYPE "(ytsossv)"
+
+enum trace_kind {
+	TRACE_SIGNAL,
+	/* reply to a method call, the member is the method */
+	TRACE_REPLY,
+};
+
+struct trace;
+struct trace_reader;
+
+struct trace *trace_new(const gchar *filename);
+void trace_write(struct trace *trace, enum trace_kind kind,
+		 const gchar *name, const gchar *path, const gchar *interface,
+		 const gchar *member, GVariant *body);
+void trace_close(struct trace *trace);
+void trace_free(struct trace *trace);
+
+struct trace_reader *trace_reader_new(const gchar *filename, GError **error);
+GVariant *trace_reader_next(struct trace_reader *reader, GError **error);
+void trace_reader_free(struct trace_reader *reader);
+
+#endif /* _CONNMAN_GTK_TRACE_H */
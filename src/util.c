@@ -20,7 +20,6 @@
 
 #include <arpa/inet.h>
 #include <glib.h>
-#include <glib/gi18n.h>
 #include <gtk/gtk.h>
 #include <string.h>
 #include <gdk/gdkkeysyms.h>
@@ -115,46 +114,6 @@ gint64 variant_to_int(GVariant *variant)
 	return 0;
 }
 
-const gchar *status_localized(const gchar *state)
-{
-	if(!strcmp(state, "idle"))
-		return _("Idle");
-	else if(!strcmp(state, "failure"))
-		return _("Failure");
-	else if(!strcmp(state, "association"))
-		return _("Association");
-	else if(!strcmp(state, "configuration"))
-		return _("Configuration");
-	else if(!strcmp(state, "ready"))
-		return _("Ready");
-	else if(!strcmp(state, "disconnect"))
-		return _("Disconnected");
-	else if(!strcmp(state, "online"))
-		return _("Online");
-	else
-		return _("Error");
-}
-
-const gchar *failure_localized(const gchar *state)
-{
-	if(!strcmp(state, "out-of-range"))
-		return _("Out of range");
-	else if(!strcmp(state, "pin-missing"))
-		return _("PIN missing");
-	else if(!strcmp(state, "dhcp-failed"))
-		return _("DHCP failed");
-	else if(!strcmp(state, "connect-failed"))
-		return _("Connecting failed");
-	else if(!strcmp(state, "login-failed"))
-		return _("Login failed");
-	else if(!strcmp(state, "auth-failed"))
-		return _("Authentication failed");
-	else if(!strcmp(state, "invalid-key"))
-		return _("Invalid key");
-	else
-		return state;
-}
-
 gboolean valid_ipv4(const gchar *address)
 {
 	char str[INET_ADDRSTRLEN];
@@ -200,19 +159,82 @@ void combo_box_changed(GtkComboBox *box, gpointer data)
 	g_free(str);
 }
 
+/*
+ * Object paths are shared by every table and struct naming the object,
+ * and freed with the last reference
+ */
+static GHashTable *paths;
+static GMutex paths_lock;
+
+const gchar *path_intern(const gchar *path)
+{
+	gpointer interned, count;
+
+	g_mutex_lock(&paths_lock);
+	if(!paths)
+		paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					      NULL);
+	if(g_hash_table_lookup_extended(paths, path, &interned, &count)) {
+		g_hash_table_insert(paths, interned,
+				    GUINT_TO_POINTER(GPOINTER_TO_UINT(count) + 1));
+	} else {
+		interned = g_strdup(path);
+		g_hash_table_insert(paths, interned, GUINT_TO_POINTER(1));
+	}
+	g_mutex_unlock(&paths_lock);
+	return interned;
+}
+
+void path_unref(const gchar *path)
+{
+	guint count;
+
+	if(!path)
+		return;
+	g_mutex_lock(&paths_lock);
+	count = GPOINTER_TO_UINT(g_hash_table_lookup(paths, path));
+	if(count > 1)
+		g_hash_table_insert(paths, (gpointer)path,
+				    GUINT_TO_POINTER(count - 1));
+	else
+		g_hash_table_remove(paths, path);
+	g_mutex_unlock(&paths_lock);
+}
+
+/*
+ * Property names and subkeys are quarks, ConnMan only uses a few dozen
+ * of them. With them the table is one flat set of (key, subkey) pairs,
+ * and replacing a value allocates nothing.
+ */
+struct dual_entry {
+	GQuark key;
+	/* 0 for the property itself */
+	GQuark subkey;
+	gpointer value;
+};
+
 struct DualHashTable_t {
 	GHashTable *table;
 	GDestroyNotify free_value;
 	gint refcount;
 };
 
+static guint dual_entry_hash(gconstpointer data)
+{
+	const struct dual_entry *entry = data;
+	return entry->key * 31 + entry->subkey;
+}
+
+static gboolean dual_entry_equal(gconstpointer a, gconstpointer b)
+{
+	const struct dual_entry *first = a, *second = b;
+	return first->key == second->key && first->subkey == second->subkey;
+}
+
 DualHashTable *dual_hash_table_new(GDestroyNotify free_value)
 {
 	DualHashTable *dt = g_malloc(sizeof(*dt));
-	GDestroyNotify free_func = (GDestroyNotify)g_hash_table_unref;
-	GHashTable *table = g_hash_table_new_full(g_str_hash, g_str_equal,
-	                    g_free, free_func);
-	dt->table = table;
+	dt->table = g_hash_table_new(dual_entry_hash, dual_entry_equal);
 	dt->free_value = free_value;
 	dt->refcount = 1;
 	return dt;
@@ -221,71 +243,82 @@ DualHashTable *dual_hash_table_new(GDestroyNotify free_value)
 DualHashTable *dual_hash_table_ref(DualHashTable *table)
 {
 	g_atomic_int_inc(&table->refcount);
-	g_hash_table_ref(table->table);
 	return table;
 }
 
 void dual_hash_table_unref(DualHashTable *table)
 {
+	GHashTableIter iter;
+	gpointer entry;
+
+	if(!g_atomic_int_dec_and_test(&table->refcount))
+		return;
+	g_hash_table_iter_init(&iter, table->table);
+	while(g_hash_table_iter_next(&iter, &entry, NULL)) {
+		struct dual_entry *e = entry;
+		if(table->free_value)
+			table->free_value(e->value);
+		g_free(e);
+	}
 	g_hash_table_unref(table->table);
-	if(g_atomic_int_dec_and_test(&table->refcount))
-		g_free(table);
+	g_free(table);
 }
 
 void *hash_table_get_dual_key(DualHashTable *dtable, const gchar *key,
                               const gchar *subkey)
 {
-	GHashTable *table = dtable->table;
-	GHashTable *t = g_hash_table_lookup(table, key);
-	if(!t)
+	struct dual_entry probe, *entry;
+
+	/* a name never interned cannot be in any table */
+	probe.key = g_quark_try_string(key);
+	if(!probe.key)
 		return NULL;
-	if(!subkey)
-		subkey = "";
-	return g_hash_table_lookup(t, subkey);
+	probe.subkey = 0;
+	if(subkey && *subkey) {
+		probe.subkey = g_quark_try_string(subkey);
+		if(!probe.subkey)
+			return NULL;
+	}
+	entry = g_hash_table_lookup(dtable->table, &probe);
+	return entry ? entry->value : NULL;
 }
 
 void hash_table_set_dual_key(DualHashTable *dtable, const gchar *key,
                              const gchar *subkey, void *value)
 {
-	GHashTable *table = dtable->table;
-	GHashTable *t;
-	t = g_hash_table_lookup(table, key);
-	if(!t) {
-		t = g_hash_table_new_full(g_str_hash, g_str_equal,
-		                          g_free, dtable->free_value);
-		g_hash_table_insert(table, g_strdup(key), t);
-	}
-	if(!subkey)
-		subkey = "";
-	g_hash_table_insert(t, g_strdup(subkey), value);
-}
-
-struct table_cb_data {
-	DualHashTableIter cb;
-	gpointer user_data;
-	const gchar *key;
-};
-
-static void iter_cb_cb(gpointer subkey, gpointer value, gpointer user_data)
-{
-	struct table_cb_data *data = user_data;
-	if(!strcmp(subkey, ""))
-		subkey = NULL;
-	data->cb(data->key, subkey, value, data->user_data);
-}
+	struct dual_entry probe, *entry;
 
-static void iter_cb(gpointer key, gpointer value, gpointer user_data)
-{
-	struct table_cb_data *data = user_data;
-	data->key = key;
-	g_hash_table_foreach(value, iter_cb_cb, data);
+	probe.key = g_quark_from_string(key);
+	probe.subkey = subkey && *subkey ? g_quark_from_string(subkey) : 0;
+	entry = g_hash_table_lookup(dtable->table, &probe);
+	if(entry) {
+		if(dtable->free_value)
+			dtable->free_value(entry->value);
+		entry->value = value;
+		return;
+	}
+	entry = g_malloc(sizeof(*entry));
+	*entry = probe;
+	entry->value = value;
+	g_hash_table_add(dtable->table, entry);
 }
 
 void dual_hash_table_foreach(DualHashTable *table, DualHashTableIter cb,
                              gpointer user_data)
 {
-	struct table_cb_data data = {cb, user_data};
-	g_hash_table_foreach(table->table, iter_cb, &data);
+	GHashTableIter iter;
+	gpointer data;
+
+	g_hash_table_iter_init(&iter, table->table);
+	while(g_hash_table_iter_next(&iter, &data, NULL)) {
+		struct dual_entry *entry = data;
+		const gchar *subkey = NULL;
+
+		if(entry->subkey)
+			subkey = g_quark_to_string(entry->subkey);
+		cb(g_quark_to_string(entry->key), subkey, entry->value,
+		   user_data);
+	}
 }
 
 static void append_to_variant(const gchar *key, const gchar *subkey,
@@ -327,6 +360,12 @@ gboolean handle_keyboard_shortcut(GtkWidget *widget, GdkEventKey *event, gpointe
 			if (isCtrl)
 				gtk_widget_destroy(widget);
 			break;
+		case GDK_KEY_D:
+			if (isCtrl)
+				g_action_group_activate_action(
+					G_ACTION_GROUP(g_application_get_default()),
+					"statistics", NULL);
+			break;
 	}
 
 	return FALSE;
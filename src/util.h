@@ -31,13 +31,14 @@ gchar *variant_to_str(GVariant *variant);
 gboolean variant_to_bool(GVariant *variant);
 guint64 variant_to_uint(GVariant *variant);
 gint64 variant_to_int(GVariant *variant);
-const gchar *status_localized(const gchar *status);
-const gchar *failure_localized(const gchar *status);
 gboolean valid_ipv4(const gchar *address);
 gboolean valid_ipv6(const gchar *address);
 void list_item_selected(GtkListBox *box, GtkListBoxRow *row, gpointer data);
 void combo_box_changed(GtkComboBox *widget, gpointer data);
 
+const gchar *path_intern(const gchar *path);
+void path_unref(const gchar *path);
+
 typedef struct DualHashTable_t DualHashTable;
 typedef void(*DualHashTableIter)(const gchar *key, const gchar *subkey,
                                  gpointer value, gpointer user_data);
@@ -22,79 +22,42 @@
 #include <glib/gi18n.h>
 
 #include "config.h"
-#include "dialog.h"
+#include "host.h"
 #include "interfaces.h"
 #include "main.h"
 #include "technology.h"
 #include "service.h"
 #include "vpn.h"
 
-static struct technology *tech;
-static GDBusConnection *connection;
-static GDBusProxy *proxy;
-int connection_count;
-
-static void add_connection(GDBusConnection *connection, GVariant *parameters)
-{
-	GVariant *path_v, *properties;
-	const gchar *path;
-
-	path_v = g_variant_get_child_value(parameters, 0);
-	properties = g_variant_get_child_value(parameters, 1);
-	path = g_variant_get_string(path_v, NULL);
-
-	gtk_widget_show(tech->list_item->item);
-	gtk_widget_show(tech->settings->grid);
-	connection_count++;
-	modify_service(g_dbus_proxy_get_connection(proxy), path,
-		       properties);
-
-	g_variant_unref(path_v);
-	g_variant_unref(properties);
-}
-
-static void remove_connection(GVariant *parameters)
+static void vpn_signal(const struct router_delta *delta, gpointer user_data)
 {
-	GVariant *path_v;
-	const gchar *path;
+	struct host *host = user_data;
 
-	path_v = g_variant_get_child_value(parameters, 0);
-	path = g_variant_get_string(path_v, NULL);
-	connection_count--;
-
-	if(!connection_count) {
-		gtk_widget_hide(tech->list_item->item);
-		gtk_widget_hide(tech->settings->grid);
-	}
-
-	remove_service(path);
-
-	g_variant_unref(path_v);
-}
-
-static void vpn_signal(GDBusProxy *proxy, gchar *sender, gchar *signal,
-                       GVariant *parameters, gpointer user_data)
-{
-	if(!strcmp(signal, "ConnectionAdded"))
-		add_connection(g_dbus_proxy_get_connection(proxy), parameters);
-	else if(!strcmp(signal, "ConnectionRemoved"))
-		remove_connection(parameters);
+	if(!strcmp(delta->signal, "ConnectionAdded"))
+		modify_service(host, delta->object, delta->value);
+	else if(!strcmp(delta->signal, "ConnectionRemoved"))
+		remove_service(host, delta->object);
 }
 
-static void add_all_connections(GDBusConnection *Connection,
-				GVariant *connections_v)
+static void add_all_connections(struct host *host, GVariant *connections_v)
 {
 	int i;
 	int size = g_variant_n_children(connections_v);
 	for(i = 0; i < size; i++) {
-		GVariant *child = g_variant_get_child_value(connections_v, i);
-		add_connection(connection, child);
+		GVariant *child, *properties;
+		const gchar *path;
+
+		child = g_variant_get_child_value(connections_v, i);
+		g_variant_get(child, "(&o@a{sv})", &path, &properties);
+		modify_service(host, path, properties);
+		g_variant_unref(properties);
 		g_variant_unref(child);
 	}
 }
 
-static struct technology *create_vpn_technology(void)
+static struct technology *create_vpn_technology(struct router *router)
 {
+	struct technology *tech;
 	GVariant *properties;
 	GVariantBuilder *b;
 
@@ -108,49 +71,18 @@ static struct technology *create_vpn_technology(void)
 	g_variant_builder_add(b, "{sv}", "Powered",
 	                      g_variant_new_boolean(TRUE));
 	properties = g_variant_builder_end(b);
-	tech = technology_create(proxy, "/net/connman/technologies/vpn",
+	tech = technology_create(router, "/net/connman/technologies/vpn",
 				 properties);
-	gtk_widget_hide(tech->settings->power_switch);
-	gtk_widget_hide(tech->settings->tethering);
-	gtk_widget_hide(tech->list_item->item);
-	gtk_widget_hide(tech->settings->grid);
 	g_variant_unref(properties);
 	g_variant_builder_unref(b);
 
 	return tech;
 }
 
-struct technology *vpn_register(GDBusConnection *conn, GtkWidget *list,
-                                GtkWidget *notebook)
+struct technology *vpn_register(struct host *host)
 {
-	GDBusNodeInfo *info;
-	GDBusInterfaceInfo *interface;
-	GError *error = NULL;
-
-	connection = conn;
-	info = g_dbus_node_info_new_for_xml(VPN_MANAGER_INTERFACE, &error);
-	if(error) {
-		g_critical("Failed to load VPN manager interface: %s",
-		           error->message);
-		g_error_free(error);
-		return NULL;
-	}
-
-	interface = g_dbus_node_info_lookup_interface(info, VPN_MANAGER_NAME);
-	proxy = g_dbus_proxy_new_sync(connection, G_DBUS_PROXY_FLAGS_NONE,
-	                              interface, CONNMAN_PATH ".vpn", "/",
-	                              VPN_MANAGER_NAME, NULL, &error);
-	g_dbus_node_info_unref(info);
-	if(error) {
-		g_warning("Failed to connect to ConnMan: %s", error->message);
-		show_error(_("Failed to connect to ConnMan."), error->message);
-		g_error_free(error);
-		return NULL;
-	}
-
-	g_signal_connect(proxy, "g-signal", G_CALLBACK(vpn_signal), NULL);
-	tech = create_vpn_technology();
-	return tech;
+	router_add(host->router, CONNMAN_VPN_PATH, "/", vpn_signal, host);
+	return create_vpn_technology(host->router);
 }
 
 void vpn_update_status(struct technology *tech)
@@ -158,20 +90,29 @@ void vpn_update_status(struct technology *tech)
 	GHashTableIter iter;
 	gpointer key, value;
 	struct technology_settings *item;
+	gboolean visible;
 	int status = 0;
 
 	item = tech->settings;
+	if(!item)
+		return;
+
+	/* the page is only shown when there are connections */
+	gtk_widget_hide(item->power_switch);
+	gtk_widget_hide(item->tethering);
+	visible = g_hash_table_size(tech->services) > 0;
+	gtk_widget_set_visible(tech->list_item->item, visible);
+	gtk_widget_set_visible(item->grid, visible);
+
 	g_hash_table_iter_init(&iter, tech->services);
 	while(g_hash_table_iter_next(&iter, &key, &value)) {
-		gchar *state;
+		struct service *serv = value;
 
-		state = service_get_property_string_raw(value, "State", NULL);
-		if(status < 2 && !strcmp(state, "ready"))
+		if(status < 2 && serv->state == SERVICE_STATE_READY)
 			status = 2;
-		else if(status < 1 && !strcmp(state, "configuration"))
+		else if(status < 1 &&
+			serv->state == SERVICE_STATE_CONFIGURATION)
 			status = 1;
-
-		g_free(state);
 	}
 
 	gtk_label_set_text(GTK_LABEL(item->title), _("VPN"));
@@ -183,29 +124,29 @@ void vpn_update_status(struct technology *tech)
 		gtk_label_set_text(GTK_LABEL(item->status), _("Not connected"));
 }
 
-void vpn_get_connections(GDBusProxy *manager_proxy)
+static void get_connections_cb(GVariant *data, const GError *error,
+			       gpointer user_data)
 {
-	GVariant *data, *child;
-	GError *error = NULL;
-	proxy = manager_proxy;
-	data = g_dbus_proxy_call_sync(proxy, "GetConnections", NULL,
-	                              G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+	struct host *host = user_data;
+	GVariant *child;
+
+	startup_call_done();
 	if(error) {
-		g_warning("failed to get vpn connections: %s", error->message);
-		g_error_free(error);
-		g_object_unref(proxy);
+		if(!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning("failed to get vpn connections: %s",
+				  error->message);
 		return;
 	}
 
 	child = g_variant_get_child_value(data, 0);
-	add_all_connections(connection, child);
-	g_variant_unref(data);
+	add_all_connections(host, child);
 	g_variant_unref(child);
 }
 
-void vpn_release(void)
+void vpn_get_connections(struct host *host)
 {
-	connection_count = 0;
-	proxy = NULL;
-	tech = NULL;
+	startup_call_begin();
+	router_call(host->router, CONNMAN_VPN_PATH, "/", VPN_MANAGER_NAME,
+		    "GetConnections", NULL, host->vpn_cancellable,
+		    get_connections_cb, host);
 }
@@ -23,11 +23,13 @@
 
 #include <glib.h>
 
+#include "router.h"
 #include "technology.h"
 
-struct technology *vpn_register(GDBusConnection *connection, GtkWidget *list,
-                                GtkWidget *notebook);
+struct host;
+
+struct technology *vpn_register(struct host *host);
 void vpn_update_status(struct technology *tech);
-void vpn_get_connections(GDBusProxy *proxy);
+void vpn_get_connections(struct host *host);
 
 #endif /* _CONNMAN_GTK_VPN_H */
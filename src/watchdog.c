@@ -0,0 +1,323 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* for pthread_kill and sigaction under -std=c11 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib-unix.h>
+
+#include "config.h"
+#include "watchdog.h"
+
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+
+/*
+ * The main context's poll function is wrapped, so the main thread notes
+ * when it stops waiting and starts dispatching. A thread of our own
+ * looks at that note every half threshold. When an iteration runs past
+ * the threshold the main thread is interrupted with SIGURG to take a
+ * backtrace of whatever it is dispatching, and when the iteration
+ * finally ends its length goes to the statistics. The statistics are
+ * printed on SIGUSR1 and on exit.
+ */
+
+#define WATCHDOG_FRAMES 64
+/* Stalls whose backtraces are kept for the dump */
+#define WATCHDOG_RECENT 8
+
+gint watchdog_threshold;
+
+struct stall {
+	gint64 time;
+	gchar *backtrace;
+};
+
+static GPollFunc real_poll;
+static pthread_t main_thread;
+static GThread *thread;
+static GMainContext *context;
+static GMainLoop *loop;
+
+/* guards everything below */
+static GMutex lock;
+static gint64 busy_since;
+/* starts at 1, so nothing counts as reported before the first stall */
+static guint64 iteration = 1;
+static guint64 reported_iteration;
+
+static const guint bucket_ms[] = { 100, 250, 500, 1000, 2500, 5000, 10000 };
+static guint buckets[G_N_ELEMENTS(bucket_ms) + 1];
+static guint stalls;
+static gint64 stall_total;
+static gint64 stall_max;
+static struct stall recent[WATCHDOG_RECENT];
+static guint recent_next;
+
+#ifdef HAVE_EXECINFO_H
+/* written by the signal handler on the main thread */
+static void *frames[WATCHDOG_FRAMES];
+static volatile gint frame_count;
+static gint captured;
+
+static void capture_backtrace(int signum)
+{
+	frame_count = backtrace(frames, WATCHDOG_FRAMES);
+	g_atomic_int_set(&captured, 1);
+}
+
+static gchar *main_backtrace(void)
+{
+	GString *str;
+	gchar **symbols;
+	gint i;
+
+	g_atomic_int_set(&captured, 0);
+	if(pthread_kill(main_thread, SIGURG))
+		return NULL;
+	/* the handler runs as soon as the thread is scheduled */
+	for(i = 0; i < 100 && !g_atomic_int_get(&captured); i++)
+		g_usleep(1000);
+	if(!g_atomic_int_get(&captured))
+		return NULL;
+
+	symbols = backtrace_symbols(frames, frame_count);
+	if(!symbols)
+		return NULL;
+	str = g_string_new(NULL);
+	/* skip the handler and the signal trampoline */
+	for(i = 2; i < frame_count; i++)
+		g_string_append_printf(str, "\t%s\n", symbols[i]);
+	free(symbols);
+	return g_string_free(str, FALSE);
+}
+
+static void backtrace_init(void)
+{
+	struct sigaction action;
+	void *frame;
+
+	/* backtrace() loads libgcc on first use, not in a handler please */
+	backtrace(&frame, 1);
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = capture_backtrace;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGURG, &action, NULL);
+}
+#else
+static gchar *main_backtrace(void)
+{
+	return NULL;
+}
+
+static void backtrace_init(void)
+{
+}
+#endif
+
+static gint watchdog_poll(GPollFD *fds, guint nfds, gint timeout)
+{
+	gint64 now = g_get_monotonic_time();
+	gint64 duration;
+	gboolean reported;
+	gint ret;
+	guint i;
+
+	g_mutex_lock(&lock);
+	duration = busy_since ? now - busy_since : 0;
+	reported = reported_iteration == iteration;
+	busy_since = 0;
+	if(duration >= watchdog_threshold * 1000) {
+		for(i = 0; i < G_N_ELEMENTS(bucket_ms); i++)
+			if(duration < bucket_ms[i] * 1000)
+				break;
+		buckets[i]++;
+		stalls++;
+		stall_total += duration;
+		stall_max = MAX(stall_max, duration);
+	}
+	g_mutex_unlock(&lock);
+
+	if(reported)
+		g_warning("Main loop stall ended after %" G_GINT64_FORMAT
+			  " ms", duration / 1000);
+
+	ret = real_poll(fds, nfds, timeout);
+
+	g_mutex_lock(&lock);
+	busy_since = g_get_monotonic_time();
+	iteration++;
+	g_mutex_unlock(&lock);
+	return ret;
+}
+
+static gboolean watchdog_check(gpointer user_data)
+{
+	gint64 busy, now = g_get_monotonic_time();
+	struct stall *stall;
+	gchar *trace;
+	guint64 current;
+
+	g_mutex_lock(&lock);
+	busy = busy_since;
+	current = iteration;
+	if(!busy || now - busy < watchdog_threshold * 1000 ||
+	   reported_iteration == current) {
+		g_mutex_unlock(&lock);
+		return G_SOURCE_CONTINUE;
+	}
+	reported_iteration = current;
+	g_mutex_unlock(&lock);
+
+	trace = main_backtrace();
+	g_warning("Main loop stalled for %" G_GINT64_FORMAT " ms%s%s",
+		  (now - busy) / 1000, trace ? ", dispatching:\n" : "",
+		  trace ? trace : "");
+
+	g_mutex_lock(&lock);
+	stall = &recent[recent_next++ % WATCHDOG_RECENT];
+	g_free(stall->backtrace);
+	stall->time = g_get_real_time();
+	stall->backtrace = trace;
+	g_mutex_unlock(&lock);
+	return G_SOURCE_CONTINUE;
+}
+
+void watchdog_dump(void)
+{
+	GString *str = g_string_new(NULL);
+	guint i;
+
+	g_mutex_lock(&lock);
+	g_string_append_printf(str, "%u main loop stalls over %d ms",
+			       stalls, watchdog_threshold);
+	if(stalls)
+		g_string_append_printf(str, ", mean %" G_GINT64_FORMAT
+				       " ms, longest %" G_GINT64_FORMAT " ms",
+				       stall_total / stalls / 1000,
+				       stall_max / 1000);
+	g_string_append_c(str, '\n');
+	for(i = 0; i < G_N_ELEMENTS(buckets); i++) {
+		if(!buckets[i])
+			continue;
+		if(i < G_N_ELEMENTS(bucket_ms))
+			g_string_append_printf(str, "\t< %5u ms: %u\n",
+					       bucket_ms[i], buckets[i]);
+		else
+			g_string_append_printf(str, "\t>= %4u ms: %u\n",
+					       bucket_ms[i - 1], buckets[i]);
+	}
+	for(i = 0; i < WATCHDOG_RECENT; i++) {
+		struct stall *stall = &recent[(recent_next + i) %
+					      WATCHDOG_RECENT];
+		GDateTime *time;
+		gchar *stamp;
+
+		if(!stall->time)
+			continue;
+		time = g_date_time_new_from_unix_local(stall->time /
+						       G_USEC_PER_SEC);
+		stamp = g_date_time_format(time, "%T");
+		g_string_append_printf(str, "stall at %s:\n%s", stamp,
+				       stall->backtrace ? stall->backtrace :
+				       "\t(no backtrace)\n");
+		g_free(stamp);
+		g_date_time_unref(time);
+	}
+	g_mutex_unlock(&lock);
+
+	g_message("%s", str->str);
+	g_string_free(str, TRUE);
+}
+
+static gboolean watchdog_signal(gpointer user_data)
+{
+	watchdog_dump();
+	return G_SOURCE_CONTINUE;
+}
+
+/* The dump is served from here too, a wedged main loop cannot do it */
+static gpointer watchdog_thread(gpointer user_data)
+{
+	GSource *source;
+	guint interval = MAX((guint)watchdog_threshold / 2, 10);
+
+	g_main_context_push_thread_default(context);
+
+	source = g_timeout_source_new(interval);
+	g_source_set_callback(source, watchdog_check, NULL, NULL);
+	g_source_attach(source, context);
+	g_source_unref(source);
+
+	source = g_unix_signal_source_new(SIGUSR1);
+	g_source_set_callback(source, watchdog_signal, NULL, NULL);
+	g_source_attach(source, context);
+	g_source_unref(source);
+
+	g_main_loop_run(loop);
+	g_main_context_pop_thread_default(context);
+	return NULL;
+}
+
+void watchdog_start(void)
+{
+	GMainContext *main_context = g_main_context_default();
+
+	if(watchdog_threshold <= 0 || thread)
+		return;
+
+	main_thread = pthread_self();
+	backtrace_init();
+	real_poll = g_main_context_get_poll_func(main_context);
+	g_main_context_set_poll_func(main_context, watchdog_poll);
+
+	context = g_main_context_new();
+	loop = g_main_loop_new(context, FALSE);
+	thread = g_thread_new("watchdog", watchdog_thread, NULL);
+}
+
+void watchdog_stop(void)
+{
+	guint i;
+
+	if(!thread)
+		return;
+
+	g_main_context_set_poll_func(g_main_context_default(), real_poll);
+	g_main_loop_quit(loop);
+	g_thread_join(thread);
+	thread = NULL;
+	g_main_loop_unref(loop);
+	g_main_context_unref(context);
+
+	if(stalls)
+		watchdog_dump();
+	for(i = 0; i < WATCHDOG_RECENT; i++)
+		g_clear_pointer(&recent[i].backtrace, g_free);
+}
@@ -26,6 +26,7 @@
 #include "config.h"
 #include "dialog.h"
 #include "main.h"
+#include "probes.h"
 #include "style.h"
 #include "technology.h"
 #include "wireless.h"
@@ -38,11 +39,16 @@ struct wireless_service {
 	GtkWidget *signal;
 };
 
+/* The technology may be gone by now, only its path is kept for the call */
 static void scan_cb_cb(GObject *source, GAsyncResult *res, gpointer user_data)
 {
+	gchar *path = user_data;
 	GVariant *ret;
 	GError *error = NULL;
-	ret = g_dbus_proxy_call_finish((GDBusProxy *)user_data, res, &error);
+	ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res,
+					    &error);
+	PROBE_CALL_END(path, error ? error->message : "");
+	g_free(path);
 	if(error) {
 		g_warning("failed to scan wifi: %s", error->message);
 		g_error_free(error);
@@ -54,33 +60,52 @@ static void scan_cb_cb(GObject *source, GAsyncResult *res, gpointer user_data)
 static gboolean scan_cb(gpointer user_data)
 {
 	struct technology *tech = user_data;
-	GHashTable *properties = tech->settings->properties;
+	GHashTable *properties = tech->properties;
 	if(!variant_to_bool(g_hash_table_lookup(properties, "Powered")))
 		return TRUE;
 	if(variant_to_bool(g_hash_table_lookup(properties, "Tethering")))
 		return TRUE;
 
-	g_dbus_proxy_call(tech->settings->proxy, "Scan", NULL,
-	                  G_DBUS_CALL_FLAGS_NONE, -1, NULL, scan_cb_cb,
-	                  tech->settings->proxy);
+	PROBE_CALL_BEGIN(tech->path, "Scan");
+	technology_call(tech, "Scan", NULL, scan_cb_cb, g_strdup(tech->path));
 	return TRUE;
 }
 
-void technology_wireless_free(struct technology *tech)
+/*
+ * Scanning makes ConnMan report every network again, which is only worth
+ * handling while the page showing them exists. A stale technology is not
+ * scanned, ConnMan may not have it or may not be running at all.
+ */
+void technology_wireless_update_scan(struct technology *tech)
 {
-	g_source_remove(GPOINTER_TO_INT(tech->data));
+	guint id = GPOINTER_TO_UINT(tech->data);
+	gboolean wanted = tech->settings && !tech->stale;
+
+	if(wanted == (id != 0))
+		return;
+
+	if(wanted) {
+		scan_cb(tech);
+		id = g_timeout_add_seconds(WIRELESS_SCAN_INTERVAL, scan_cb,
+					   tech);
+	} else {
+		g_source_remove(id);
+		id = 0;
+	}
+	tech->data = GUINT_TO_POINTER(id);
 }
 
-void technology_wireless_init(struct technology *tech, GVariant *properties,
-                              GDBusProxy *proxy)
+void technology_wireless_free(struct technology *tech)
 {
-	int id;
+	guint id = GPOINTER_TO_UINT(tech->data);
 
-	scan_cb(tech);
-	id = g_timeout_add_seconds(WIRELESS_SCAN_INTERVAL,
-				   scan_cb, tech);
-	tech->data = GINT_TO_POINTER(id);
+	if(id)
+		g_source_remove(id);
+}
 
+void technology_wireless_init(struct technology *tech, GVariant *properties)
+{
+	tech->data = NULL;
 }
 
 void service_wireless_free(struct service *tech)
@@ -131,9 +156,9 @@ void technology_wireless_tether(struct technology *tech)
 
 	title = _("Set Access Point SSID and passphrase");
 
-	old_ssid = g_hash_table_lookup(tech->settings->properties,
+	old_ssid = g_hash_table_lookup(tech->properties,
 				       "TetheringIdentifier");
-	old_pass = g_hash_table_lookup(tech->settings->properties,
+	old_pass = g_hash_table_lookup(tech->properties,
 				       "TetheringPassphrase");
 
 	if(old_ssid)
@@ -164,8 +189,7 @@ out:
 	g_ptr_array_free(tokens, TRUE);
 }
 
-void service_wireless_init(struct service *serv, GDBusProxy *proxy,
-                           const gchar *path, GVariant *properties)
+void service_wireless_init(struct service *serv)
 {
 	struct wireless_service *item = g_malloc(sizeof(*serv));
 
@@ -197,8 +221,6 @@ void service_wireless_init(struct service *serv, GDBusProxy *proxy,
 
 	gtk_widget_show_all(serv->header);
 	gtk_widget_hide(serv->contents);
-
-	service_wireless_update(serv);
 }
 
 void service_wireless_update(struct service *serv)
@@ -208,52 +230,34 @@ void service_wireless_update(struct service *serv)
 	GtkStyleContext *context;
 	int width;
 
-	GVariant *variant;
-	int strength;
-
-	variant = service_get_property(serv, "Security", NULL);
-	if(variant) {
-		const gchar **value;
-		const gchar **cur;
-		int security = 0;
-		const gchar *icon_name;
-		value = g_variant_get_strv(variant, NULL);
-		for(cur = value; *cur; cur++) {
-			if(!strcmp("ieee8021x", *cur)) {
-				security = 3;
-				break;
-			}
-			if(!strcmp("psk", *cur))
-				security = 2;
-			else if(security < 2 && !strcmp("wps", *cur))
-				security = 1;
-		}
-		g_free(value);
-		icon_name = (security == 3 ? "security-high-symbolic" :
-		             security == 2 ? "security-medium-symbolic" :
-		             security == 1 ? "security-low-symbolic" :
-		             NULL);
-		gtk_image_set_from_icon_name(GTK_IMAGE(item->security),
-		                             icon_name, GTK_ICON_SIZE_MENU);
-		if(!security) {
-			gtk_widget_hide(item->security);
-			style_set_margin_end(item->favourite,
-						  3*MARGIN_SMALL + 16);
-		} else {
-			gtk_widget_show(item->security);
-			style_set_margin_end(item->favourite,
-						  MARGIN_SMALL);
-		}
-		g_variant_unref(variant);
-	} else
+	enum service_security security;
+	const gchar *icon_name;
+
+	if(!item)
+		return;
+
+	security = serv->security;
+	icon_name = (security == SERVICE_SECURITY_IEEE8021X ?
+		     "security-high-symbolic" :
+		     security == SERVICE_SECURITY_PSK ?
+		     "security-medium-symbolic" :
+		     security == SERVICE_SECURITY_WPS ?
+		     "security-low-symbolic" : NULL);
+	gtk_image_set_from_icon_name(GTK_IMAGE(item->security),
+	                             icon_name, GTK_ICON_SIZE_MENU);
+	if(security == SERVICE_SECURITY_NONE) {
 		gtk_widget_hide(item->security);
+		style_set_margin_end(item->favourite, 3*MARGIN_SMALL + 16);
+	} else {
+		gtk_widget_show(item->security);
+		style_set_margin_end(item->favourite, MARGIN_SMALL);
+	}
 
-	strength = service_get_property_int(serv, "Strength", NULL);
 	gtk_image_set_from_icon_name(GTK_IMAGE(item->signal),
-	                             SIGNAL_TO_ICON("wireless", strength),
+	                             SIGNAL_TO_ICON("wireless", serv->strength),
 	                             GTK_ICON_SIZE_MENU);
 
-	if(service_get_property_boolean(serv, "Favorite", NULL))
+	if(serv->flags & SERVICE_FAVORITE)
 		gtk_widget_show(item->favourite);
 	else
 		gtk_widget_hide(item->favourite);
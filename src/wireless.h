@@ -29,13 +29,12 @@
 #define WIRELESS_SCAN_INTERVAL 30
 
 void technology_wireless_free(struct technology *serv);
-void technology_wireless_init(struct technology *item, GVariant *properties,
-                              GDBusProxy *proxy);
+void technology_wireless_init(struct technology *item, GVariant *properties);
+void technology_wireless_update_scan(struct technology *item);
 void technology_wireless_tether(struct technology *item);
 
 void service_wireless_free(struct service *serv);
-void service_wireless_init(struct service *serv, GDBusProxy *proxy,
-                           const gchar *path, GVariant *properties);
+void service_wireless_init(struct service *serv);
 void service_wireless_update(struct service *serv);
 
 #endif /* _CONNMAN_GTK_WIRELESS_H */
@@ -0,0 +1,758 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "interfaces.h"
+#include "mock.h"
+
+/* Signals sent per main loop iteration when not rate limited */
+#define MOCK_BATCH 256
+
+struct mock_object {
+	gchar *path;
+	const gchar *interface;
+	/* services only: technology type and the name they were created with */
+	gchar *type;
+	gchar *name;
+	GHashTable *properties;
+	/* bumped by Connect and Disconnect, ends an older connect early */
+	guint connect_serial;
+};
+
+struct mock {
+	gchar *address;
+
+	GPtrArray *technologies;
+	GPtrArray *services;
+	GPtrArray *connections;
+	GHashTable *objects;
+
+	GThread *thread;
+	GMainContext *context;
+	GMainLoop *loop;
+	GDBusConnection *connman;
+	GDBusConnection *vpn;
+	GMutex lock;
+	GCond cond;
+	/* 0 while starting, 1 once serving, -1 if that failed */
+	gint state;
+
+	GSource *update_source;
+	guint updates_total;
+	guint updates_sent;
+	guint rate;
+	gint64 updates_start;
+
+	guint connect_step;
+	guint connect_fail;
+	guint connects;
+};
+
+struct mock_connect {
+	struct mock *mock;
+	struct mock_object *object;
+	guint serial;
+	guint step;
+	gboolean fail;
+};
+
+struct mock_updates {
+	struct mock *mock;
+	guint count;
+	guint rate;
+};
+
+static struct mock_object *object_new(struct mock *mock, const gchar *path,
+				      const gchar *interface)
+{
+	struct mock_object *object = g_malloc0(sizeof(*object));
+
+	object->path = g_strdup(path);
+	object->interface = interface;
+	object->properties = g_hash_table_new_full(g_str_hash, g_str_equal,
+						   g_free,
+						   (GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(mock->objects, object->path, object);
+	return object;
+}
+
+static void object_free(gpointer data)
+{
+	struct mock_object *object = data;
+
+	g_hash_table_unref(object->properties);
+	g_free(object->path);
+	g_free(object->type);
+	g_free(object->name);
+	g_free(object);
+}
+
+static void object_set(struct mock_object *object, const gchar *name,
+		       GVariant *value)
+{
+	g_hash_table_replace(object->properties, g_strdup(name),
+			     g_variant_ref_sink(value));
+}
+
+static GVariant *object_properties(struct mock_object *object)
+{
+	GVariantBuilder builder;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sv}"));
+	g_hash_table_iter_init(&iter, object->properties);
+	while(g_hash_table_iter_next(&iter, &key, &value))
+		g_variant_builder_add(&builder, "{sv}", key, value);
+	return g_variant_builder_end(&builder);
+}
+
+static GVariant *object_list(GPtrArray *objects)
+{
+	GVariantBuilder builder;
+	guint i;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a(oa{sv})"));
+	for(i = 0; i < objects->len; i++) {
+		struct mock_object *object = g_ptr_array_index(objects, i);
+
+		g_variant_builder_add(&builder, "(o@a{sv})", object->path,
+				      object_properties(object));
+	}
+	return g_variant_new("(@a(oa{sv}))", g_variant_builder_end(&builder));
+}
+
+static GVariant *empty_dict(void)
+{
+	return g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0);
+}
+
+static GVariant *method_dict(const gchar *method)
+{
+	GVariantDict dict;
+
+	g_variant_dict_init(&dict, NULL);
+	g_variant_dict_insert(&dict, "Method", "s", method);
+	return g_variant_dict_end(&dict);
+}
+
+struct mock *mock_new(const gchar *address)
+{
+	struct mock *mock = g_malloc0(sizeof(*mock));
+
+	interfaces_init();
+	mock->address = g_strdup(address);
+	mock->technologies = g_ptr_array_new();
+	mock->services = g_ptr_array_new();
+	mock->connections = g_ptr_array_new();
+	mock->objects = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+					      object_free);
+	g_mutex_init(&mock->lock);
+	g_cond_init(&mock->cond);
+	return mock;
+}
+
+void mock_add_technology(struct mock *mock, const gchar *type,
+			 gboolean powered)
+{
+	struct mock_object *object;
+	gchar *path;
+
+	path = g_strdup_printf("/net/connman/technology/%s", type);
+	object = object_new(mock, path, TECHNOLOGY_NAME);
+	g_free(path);
+
+	object_set(object, "Name", g_variant_new_string(type));
+	object_set(object, "Type", g_variant_new_string(type));
+	object_set(object, "Powered", g_variant_new_boolean(powered));
+	object_set(object, "Connected", g_variant_new_boolean(FALSE));
+	object_set(object, "Tethering", g_variant_new_boolean(FALSE));
+	g_ptr_array_add(mock->technologies, object);
+}
+
+/* Roughly what ConnMan reports for an unconfigured service */
+void mock_add_services(struct mock *mock, const gchar *type, guint count)
+{
+	const gchar *security[] = { "psk", NULL };
+	const gchar *none[] = { NULL };
+	guint i;
+
+	for(i = 0; i < count; i++) {
+		struct mock_object *object;
+		gchar *path;
+
+		path = g_strdup_printf("/net/connman/service/%s_mock_%u",
+				       type, mock->services->len);
+		object = object_new(mock, path, SERVICE_NAME);
+		g_free(path);
+		object->type = g_strdup(type);
+		object->name = g_strdup_printf("%s %u", type,
+					       mock->services->len);
+
+		object_set(object, "Name", g_variant_new_string(object->name));
+		object_set(object, "Type", g_variant_new_string(type));
+		object_set(object, "State", g_variant_new_string("idle"));
+		object_set(object, "Error", g_variant_new_string(""));
+		object_set(object, "Favorite", g_variant_new_boolean(FALSE));
+		object_set(object, "Immutable", g_variant_new_boolean(FALSE));
+		object_set(object, "AutoConnect",
+			   g_variant_new_boolean(FALSE));
+		if(!strcmp(type, "wifi")) {
+			object_set(object, "Strength",
+				   g_variant_new_byte((guchar)(i % 100 + 1)));
+			object_set(object, "Security",
+				   g_variant_new_strv(security, -1));
+		}
+		object_set(object, "Nameservers",
+			   g_variant_new_strv(none, -1));
+		object_set(object, "Nameservers.Configuration",
+			   g_variant_new_strv(none, -1));
+		object_set(object, "Timeservers",
+			   g_variant_new_strv(none, -1));
+		object_set(object, "Domains", g_variant_new_strv(none, -1));
+		object_set(object, "IPv4", empty_dict());
+		object_set(object, "IPv4.Configuration", method_dict("dhcp"));
+		object_set(object, "IPv6", empty_dict());
+		object_set(object, "IPv6.Configuration", method_dict("auto"));
+		object_set(object, "Proxy", method_dict("direct"));
+		object_set(object, "Proxy.Configuration", empty_dict());
+		object_set(object, "Ethernet", method_dict("auto"));
+		g_ptr_array_add(mock->services, object);
+	}
+}
+
+void mock_add_vpn_connections(struct mock *mock, guint count)
+{
+	const gchar *none[] = { NULL };
+	guint i;
+
+	for(i = 0; i < count; i++) {
+		struct mock_object *object;
+		gchar *value;
+
+		value = g_strdup_printf("/net/connman/vpn/connection/mock_%u",
+					mock->connections->len);
+		object = object_new(mock, value, VPN_CONNECTION_NAME);
+		g_free(value);
+
+		value = g_strdup_printf("vpn %u", mock->connections->len);
+		object_set(object, "Name", g_variant_new_string(value));
+		g_free(value);
+		value = g_strdup_printf("vpn%u.example.com",
+					mock->connections->len);
+		object_set(object, "Host", g_variant_new_string(value));
+		g_free(value);
+		object_set(object, "Type", g_variant_new_string("openvpn"));
+		object_set(object, "State", g_variant_new_string("idle"));
+		object_set(object, "Domain",
+			   g_variant_new_string("example.com"));
+		object_set(object, "Immutable", g_variant_new_boolean(FALSE));
+		object_set(object, "Index", g_variant_new_int32(-1));
+		object_set(object, "IPv4", empty_dict());
+		object_set(object, "Nameservers",
+			   g_variant_new_strv(none, -1));
+		g_ptr_array_add(mock->connections, object);
+	}
+}
+
+static void property_changed(struct mock *mock, struct mock_object *object,
+			     const gchar *name, GVariant *value)
+{
+	GDBusConnection *connection;
+
+	object_set(object, name, value);
+	connection = object->interface == VPN_CONNECTION_NAME ? mock->vpn :
+							       mock->connman;
+	g_dbus_connection_emit_signal(connection, NULL, object->path,
+				      object->interface, "PropertyChanged",
+				      g_variant_new("(sv)", name, value),
+				      NULL);
+}
+
+/* The states a connect goes through, VPNs skip association and online */
+static const gchar *connect_state(struct mock_object *object, guint step)
+{
+	static const gchar *service_states[] = { "association",
+		"configuration", "ready", "online", NULL };
+	static const gchar *vpn_states[] = { "configuration", "ready", NULL };
+
+	if(object->interface == VPN_CONNECTION_NAME)
+		return vpn_states[MIN(step, G_N_ELEMENTS(vpn_states) - 1)];
+	return service_states[MIN(step, G_N_ELEMENTS(service_states) - 1)];
+}
+
+static gboolean connect_next(gpointer user_data)
+{
+	struct mock_connect *connect = user_data;
+	struct mock_object *object = connect->object;
+	const gchar *state;
+
+	if(connect->serial != object->connect_serial)
+		return G_SOURCE_REMOVE;
+
+	/* a failing connect gets as far as the association */
+	if(connect->fail && connect->step == 1) {
+		property_changed(connect->mock, object, "Error",
+				 g_variant_new_string("connect-failed"));
+		property_changed(connect->mock, object, "State",
+				 g_variant_new_string("failure"));
+		return G_SOURCE_REMOVE;
+	}
+
+	state = connect_state(object, connect->step++);
+	if(!state)
+		return G_SOURCE_REMOVE;
+	property_changed(connect->mock, object, "State",
+			 g_variant_new_string(state));
+	return G_SOURCE_CONTINUE;
+}
+
+static void connect_object(struct mock *mock, struct mock_object *object)
+{
+	struct mock_connect *connect = g_malloc0(sizeof(*connect));
+	GSource *source;
+
+	connect->mock = mock;
+	connect->object = object;
+	connect->serial = ++object->connect_serial;
+	connect->fail = mock->connect_fail &&
+			++mock->connects % mock->connect_fail == 0;
+
+	if(!mock->connect_step) {
+		while(connect_next(connect) == G_SOURCE_CONTINUE)
+			;
+		g_free(connect);
+		return;
+	}
+
+	/* pending steps go with the context when the mock stops */
+	source = g_timeout_source_new(mock->connect_step);
+	g_source_set_callback(source, connect_next, connect, g_free);
+	g_source_attach(source, mock->context);
+	g_source_unref(source);
+}
+
+static GVariant *manager_properties(void)
+{
+	GVariantDict dict;
+
+	g_variant_dict_init(&dict, NULL);
+	g_variant_dict_insert(&dict, "State", "s", "idle");
+	g_variant_dict_insert(&dict, "OfflineMode", "b", FALSE);
+	g_variant_dict_insert(&dict, "SessionMode", "b", FALSE);
+	return g_variant_new("(@a{sv})", g_variant_dict_end(&dict));
+}
+
+static void method_call(GDBusConnection *connection, const gchar *sender,
+			const gchar *path, const gchar *interface,
+			const gchar *method, GVariant *parameters,
+			GDBusMethodInvocation *invocation, gpointer user_data)
+{
+	struct mock *mock = user_data;
+	struct mock_object *object;
+	GVariant *reply = NULL;
+
+	object = g_hash_table_lookup(mock->objects, path);
+
+	if(!strcmp(method, "GetTechnologies")) {
+		reply = object_list(mock->technologies);
+	} else if(!strcmp(method, "GetServices")) {
+		reply = object_list(mock->services);
+	} else if(!strcmp(method, "GetConnections")) {
+		reply = object_list(mock->connections);
+	} else if(!strcmp(method, "GetProperties")) {
+		if(object)
+			reply = g_variant_new("(@a{sv})",
+					      object_properties(object));
+		else
+			reply = manager_properties();
+	} else if(!strcmp(method, "SetProperty") && object) {
+		const gchar *name;
+		GVariant *value;
+
+		g_variant_get(parameters, "(&sv)", &name, &value);
+		property_changed(mock, object, name, value);
+		g_variant_unref(value);
+	} else if(!strcmp(method, "Connect") && object) {
+		connect_object(mock, object);
+	} else if(!strcmp(method, "Disconnect") && object) {
+		object->connect_serial++;
+		property_changed(mock, object, "State",
+				 g_variant_new_string("idle"));
+	} else if(!strcmp(method, "Create") || !strcmp(method, "Remove")) {
+		g_dbus_method_invocation_return_dbus_error(invocation,
+				"net.connman.Error.NotSupported",
+				"Not supported by the mock");
+		return;
+	}
+
+	/* RegisterAgent, Scan and the rest only need an answer */
+	g_dbus_method_invocation_return_value(invocation, reply);
+}
+
+static const GDBusInterfaceVTable vtable = {
+	method_call,
+	NULL,
+	NULL
+};
+
+static gchar **subtree_enumerate(GDBusConnection *connection,
+				 const gchar *sender, const gchar *path,
+				 gpointer user_data)
+{
+	struct mock *mock = user_data;
+	GPtrArray *nodes = g_ptr_array_new();
+	GHashTableIter iter;
+	gpointer key;
+	gsize len = strlen(path);
+
+	g_hash_table_iter_init(&iter, mock->objects);
+	while(g_hash_table_iter_next(&iter, &key, NULL)) {
+		const gchar *object_path = key;
+
+		if(!strncmp(object_path, path, len) && object_path[len] == '/')
+			g_ptr_array_add(nodes, g_strdup(object_path + len + 1));
+	}
+	g_ptr_array_add(nodes, NULL);
+	return (gchar **)g_ptr_array_free(nodes, FALSE);
+}
+
+static struct mock_object *subtree_object(struct mock *mock,
+					  const gchar *path, const gchar *node)
+{
+	struct mock_object *object;
+	gchar *object_path;
+
+	if(!node)
+		return NULL;
+	object_path = g_strdup_printf("%s/%s", path, node);
+	object = g_hash_table_lookup(mock->objects, object_path);
+	g_free(object_path);
+	return object;
+}
+
+static enum interface_id object_interface(struct mock_object *object)
+{
+	if(object->interface == TECHNOLOGY_NAME)
+		return INTERFACE_TECHNOLOGY;
+	if(object->interface == SERVICE_NAME)
+		return INTERFACE_SERVICE;
+	return INTERFACE_VPN_CONNECTION;
+}
+
+static GDBusInterfaceInfo **subtree_introspect(GDBusConnection *connection,
+					       const gchar *sender,
+					       const gchar *path,
+					       const gchar *node,
+					       gpointer user_data)
+{
+	struct mock_object *object;
+	GDBusInterfaceInfo **infos;
+
+	object = subtree_object(user_data, path, node);
+	if(!object)
+		return NULL;
+	infos = g_new0(GDBusInterfaceInfo *, 2);
+	infos[0] = g_dbus_interface_info_ref(
+			interface_info(object_interface(object)));
+	return infos;
+}
+
+static const GDBusInterfaceVTable *subtree_dispatch(
+		GDBusConnection *connection, const gchar *sender,
+		const gchar *path, const gchar *interface, const gchar *node,
+		gpointer *out_user_data, gpointer user_data)
+{
+	struct mock_object *object;
+
+	object = subtree_object(user_data, path, node);
+	if(!object || strcmp(object->interface, interface))
+		return NULL;
+	*out_user_data = user_data;
+	return &vtable;
+}
+
+static const GDBusSubtreeVTable subtree_vtable = {
+	subtree_enumerate,
+	subtree_introspect,
+	subtree_dispatch
+};
+
+static GDBusConnection *mock_connect(struct mock *mock, const gchar *name,
+				     enum interface_id manager,
+				     const gchar *subtree)
+{
+	GDBusConnection *connection;
+	GError *error = NULL;
+	GVariant *ret;
+	guint32 owned = 0;
+
+	connection = g_dbus_connection_new_for_address_sync(mock->address,
+			G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+			G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+			NULL, NULL, &error);
+	if(!connection)
+		goto out;
+
+	if(!g_dbus_connection_register_object(connection, "/",
+					      interface_info(manager),
+					      &vtable, mock, NULL, &error) ||
+	   !g_dbus_connection_register_subtree(connection, subtree,
+			&subtree_vtable,
+			G_DBUS_SUBTREE_FLAGS_DISPATCH_TO_UNENUMERATED_NODES,
+			mock, NULL, &error))
+		goto out;
+	if(!strcmp(name, CONNMAN_PATH) &&
+	   !g_dbus_connection_register_subtree(connection,
+			"/net/connman/technology", &subtree_vtable,
+			G_DBUS_SUBTREE_FLAGS_DISPATCH_TO_UNENUMERATED_NODES,
+			mock, NULL, &error))
+		goto out;
+
+	/* 4: DBUS_NAME_FLAG_DO_NOT_QUEUE, 1: the primary owner */
+	ret = g_dbus_connection_call_sync(connection, "org.freedesktop.DBus",
+					  "/org/freedesktop/DBus",
+					  "org.freedesktop.DBus", "RequestName",
+					  g_variant_new("(su)", name, 4),
+					  G_VARIANT_TYPE("(u)"),
+					  G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+					  &error);
+	if(!ret)
+		goto out;
+	g_variant_get(ret, "(u)", &owned);
+	g_variant_unref(ret);
+	if(owned == 1)
+		return connection;
+	g_warning("Mock could not own %s, is ConnMan on that bus?", name);
+	g_object_unref(connection);
+	return NULL;
+
+out:
+	g_warning("Mock failed to serve %s: %s", name, error->message);
+	g_error_free(error);
+	g_clear_object(&connection);
+	return NULL;
+}
+
+static void mock_disconnect(GDBusConnection **connection)
+{
+	if(!*connection)
+		return;
+	g_dbus_connection_close_sync(*connection, NULL, NULL);
+	g_clear_object(connection);
+}
+
+static gpointer mock_thread(gpointer user_data)
+{
+	struct mock *mock = user_data;
+	gint state;
+
+	g_main_context_push_thread_default(mock->context);
+	mock->connman = mock_connect(mock, CONNMAN_PATH, INTERFACE_MANAGER,
+				     "/net/connman/service");
+	if(mock->connman)
+		mock->vpn = mock_connect(mock, CONNMAN_VPN_PATH,
+					 INTERFACE_VPN_MANAGER,
+					 "/net/connman/vpn/connection");
+	state = mock->vpn ? 1 : -1;
+
+	g_mutex_lock(&mock->lock);
+	mock->state = state;
+	g_cond_signal(&mock->cond);
+	g_mutex_unlock(&mock->lock);
+
+	if(state == 1)
+		g_main_loop_run(mock->loop);
+
+	if(mock->update_source) {
+		g_source_destroy(mock->update_source);
+		g_source_unref(mock->update_source);
+		mock->update_source = NULL;
+	}
+	/* closing drops the names, to the client the daemon went away */
+	mock_disconnect(&mock->connman);
+	mock_disconnect(&mock->vpn);
+	g_main_context_pop_thread_default(mock->context);
+	return NULL;
+}
+
+/*
+ * Connect walks the object through the states step_ms apart, every
+ * fail_every'th connect fails instead if fail_every is not 0.
+ */
+void mock_set_connect_timing(struct mock *mock, guint step_ms,
+			     guint fail_every)
+{
+	mock->connect_step = step_ms;
+	mock->connect_fail = fail_every;
+}
+
+gboolean mock_start(struct mock *mock)
+{
+	gint state;
+
+	mock->context = g_main_context_new();
+	mock->loop = g_main_loop_new(mock->context, FALSE);
+	mock->state = 0;
+	mock->thread = g_thread_new("mock", mock_thread, mock);
+
+	g_mutex_lock(&mock->lock);
+	while(!mock->state)
+		g_cond_wait(&mock->cond, &mock->lock);
+	state = mock->state;
+	g_mutex_unlock(&mock->lock);
+
+	if(state < 0) {
+		mock_stop(mock);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void mock_stop(struct mock *mock)
+{
+	if(!mock->thread)
+		return;
+	g_main_loop_quit(mock->loop);
+	g_thread_join(mock->thread);
+	mock->thread = NULL;
+	g_main_loop_unref(mock->loop);
+	g_main_context_unref(mock->context);
+	mock->loop = NULL;
+	mock->context = NULL;
+}
+
+/* Strength is what changes most often on a real system */
+static void send_update(struct mock *mock, guint index)
+{
+	struct mock_object *object;
+
+	object = g_ptr_array_index(mock->services,
+				   index % mock->services->len);
+	if(!strcmp(object->type, "wifi"))
+		property_changed(mock, object, "Strength",
+				 g_variant_new_byte((guchar)(index % 100 + 1)));
+	else
+		property_changed(mock, object, "State",
+				 g_variant_new_string(index % 2 ? "online" :
+						      "ready"));
+}
+
+static gboolean send_updates(gpointer user_data)
+{
+	struct mock *mock = user_data;
+	guint64 due = G_MAXUINT64;
+	guint n;
+
+	if(mock->rate)
+		due = (guint64)(g_get_monotonic_time() - mock->updates_start) *
+		      mock->rate / G_USEC_PER_SEC;
+
+	for(n = 0; n < MOCK_BATCH && mock->updates_sent < mock->updates_total &&
+	    mock->updates_sent < due; n++)
+		send_update(mock, mock->updates_sent++);
+
+	if(mock->updates_sent < mock->updates_total)
+		return G_SOURCE_CONTINUE;
+
+	property_changed(mock, g_ptr_array_index(mock->services, 0), "Name",
+			 g_variant_new_string(MOCK_SENTINEL));
+	g_dbus_connection_flush_sync(mock->connman, NULL, NULL);
+	g_source_unref(mock->update_source);
+	mock->update_source = NULL;
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean start_updates(gpointer user_data)
+{
+	struct mock_updates *updates = user_data;
+	struct mock *mock = updates->mock;
+	struct mock_object *first;
+
+	if(mock->update_source) {
+		g_source_destroy(mock->update_source);
+		g_source_unref(mock->update_source);
+	}
+
+	/* a sentinel left from the previous batch must not end this one */
+	first = g_ptr_array_index(mock->services, 0);
+	property_changed(mock, first, "Name",
+			 g_variant_new_string(first->name));
+
+	mock->updates_total = updates->count;
+	mock->updates_sent = 0;
+	mock->rate = updates->rate;
+	mock->updates_start = g_get_monotonic_time();
+	if(mock->rate)
+		mock->update_source = g_timeout_source_new(1);
+	else
+		mock->update_source = g_idle_source_new();
+	g_source_set_callback(mock->update_source, send_updates, mock, NULL);
+	g_source_attach(mock->update_source, mock->context);
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Send count PropertyChanged signals spread over the services, at rate
+ * per second or as fast as the bus takes them if rate is 0. The first
+ * service is renamed to MOCK_SENTINEL after the last one.
+ */
+void mock_emit_updates(struct mock *mock, guint count, guint rate)
+{
+	struct mock_updates *updates;
+
+	if(!mock->thread || !mock->services->len)
+		return;
+	updates = g_malloc(sizeof(*updates));
+	updates->mock = mock;
+	updates->count = count;
+	updates->rate = rate;
+	g_main_context_invoke_full(mock->context, G_PRIORITY_DEFAULT,
+				   start_updates, updates, g_free);
+}
+
+const gchar *mock_sentinel_path(struct mock *mock)
+{
+	struct mock_object *first;
+
+	if(!mock->services->len)
+		return NULL;
+	first = g_ptr_array_index(mock->services, 0);
+	return first->path;
+}
+
+void mock_free(struct mock *mock)
+{
+	if(!mock)
+		return;
+	mock_stop(mock);
+	g_ptr_array_free(mock->technologies, TRUE);
+	g_ptr_array_free(mock->services, TRUE);
+	g_ptr_array_free(mock->connections, TRUE);
+	g_hash_table_unref(mock->objects);
+	g_mutex_clear(&mock->lock);
+	g_cond_clear(&mock->cond);
+	g_free(mock->address);
+	g_free(mock);
+}
@@ -0,0 +1,51 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONNMAN_GTK_MOCK_H
+#define _CONNMAN_GTK_MOCK_H
+
+#include <glib.h>
+
+/* Name the first service is given once a batch of updates has been sent */
+#define MOCK_SENTINEL "mock-sentinel"
+
+/*
+ * A fake ConnMan on a bus of someone else's choosing. It owns
+ * net.connman and net.connman.vpn and serves the Manager, Technology,
+ * Service, vpn Manager and vpn Connection interfaces from interfaces.h
+ * out of an in-memory model, from a thread and main context of its own.
+ * The model is filled in before mock_start.
+ */
+struct mock;
+
+struct mock *mock_new(const gchar *address);
+void mock_add_technology(struct mock *mock, const gchar *type,
+			 gboolean powered);
+void mock_add_services(struct mock *mock, const gchar *type, guint count);
+void mock_add_vpn_connections(struct mock *mock, guint count);
+void mock_set_connect_timing(struct mock *mock, guint step_ms,
+			     guint fail_every);
+gboolean mock_start(struct mock *mock);
+void mock_stop(struct mock *mock);
+void mock_emit_updates(struct mock *mock, guint count, guint rate);
+const gchar *mock_sentinel_path(struct mock *mock);
+void mock_free(struct mock *mock);
+
+#endif /* _CONNMAN_GTK_MOCK_H */
@@ -0,0 +1,358 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Serves a fake ConnMan with as many services as asked for on a private
+ * bus and keeps changing them, for trying the window against sizes and
+ * signal rates no real system has.
+ *
+ *	connman-gtk-mock [--hosts=N] [--services=N] [--rate=N | --max]
+ *			 -- connman-gtk
+ *
+ * The command after -- is started with --host pointing at the bus.
+ * With --restart=S the daemon drops off the bus and comes back every S
+ * seconds. With --hosts=N there are N daemons, each on a bus of its own
+ * and each sending at the full rate, and the command is given a --host
+ * for every one of them.
+ *
+ * With --ramp=N the command is given a --frame-log too. Once its window
+ * draws, the daemon sends N signals per second, N more every RAMP_PERIOD
+ * seconds, and stops at the first step the main window dropped a frame
+ * in, printing the highest rate it kept up with.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "mock.h"
+
+#define RAMP_PERIOD 5
+
+static GMainLoop *loop;
+static GPtrArray *mocks;
+static GPid client_pid;
+
+static gint hosts = 1;
+static gint services = 100;
+static gint connections = 2;
+static gint rate;
+static gint updates;
+static gint restart;
+static gint connect_step;
+static gint connect_fail;
+static gint ramp;
+static gboolean max_speed;
+static gchar *bus_address;
+
+static gchar *ramp_log;
+static FILE *ramp_file;
+static guint ramp_rate;
+
+static void emit_updates(void)
+{
+	guint i;
+
+	for(i = 0; i < mocks->len; i++) {
+		struct mock *mock = g_ptr_array_index(mocks, i);
+
+		if(ramp) {
+			if(ramp_rate)
+				mock_emit_updates(mock, G_MAXUINT, ramp_rate);
+		} else if(rate || max_speed)
+			mock_emit_updates(mock, updates ? (guint)updates :
+					  G_MAXUINT,
+					  max_speed ? 0 : (guint)rate);
+	}
+}
+
+static gboolean mock_restart(gpointer user_data)
+{
+	guint i;
+
+	for(i = 0; i < mocks->len; i++) {
+		struct mock *mock = g_ptr_array_index(mocks, i);
+
+		mock_stop(mock);
+		if(!mock_start(mock)) {
+			g_main_loop_quit(loop);
+			return G_SOURCE_REMOVE;
+		}
+	}
+	printf("Mock restarted\n");
+	emit_updates();
+	return G_SOURCE_CONTINUE;
+}
+
+/* Frames and dropped frames of the main window logged since last time */
+static void read_frames(guint *frames, guint *dropped)
+{
+	gchar line[256];
+	gchar **fields;
+	long offset;
+
+	*frames = 0;
+	*dropped = 0;
+	for(;;) {
+		offset = ftell(ramp_file);
+		if(!fgets(line, sizeof(line), ramp_file))
+			break;
+		/* the client is still writing this one */
+		if(!strchr(line, '\n')) {
+			fseek(ramp_file, offset, SEEK_SET);
+			break;
+		}
+		if(!g_str_has_prefix(line, "main,"))
+			continue;
+		fields = g_strsplit(line, ",", 0);
+		if(g_strv_length(fields) > 3) {
+			(*frames)++;
+			*dropped += (guint)atoi(fields[3]);
+		}
+		g_strfreev(fields);
+	}
+	clearerr(ramp_file);
+}
+
+static gboolean ramp_step(gpointer user_data)
+{
+	guint frames, dropped;
+
+	if(!ramp_file)
+		ramp_file = fopen(ramp_log, "r");
+	if(!ramp_file)
+		return G_SOURCE_CONTINUE;
+	read_frames(&frames, &dropped);
+
+	if(!ramp_rate) {
+		/* what start-up dropped is not counted against a rate */
+		if(!frames)
+			return G_SOURCE_CONTINUE;
+		ramp_rate = (guint)ramp;
+	} else if(dropped) {
+		printf("%u signals/s: %u frames, %u dropped\n", ramp_rate,
+		       frames, dropped);
+		printf("Sustained %u signals/s without dropping frames\n",
+		       ramp_rate - (guint)ramp);
+		g_main_loop_quit(loop);
+		return G_SOURCE_REMOVE;
+	} else {
+		printf("%u signals/s: %u frames, none dropped\n", ramp_rate,
+		       frames);
+		ramp_rate += (guint)ramp;
+	}
+	fflush(stdout);
+	emit_updates();
+	return G_SOURCE_CONTINUE;
+}
+
+static void client_exited(GPid pid, gint status, gpointer user_data)
+{
+	g_spawn_close_pid(pid);
+	client_pid = 0;
+	if(ramp) {
+		fprintf(stderr, "The client exited before dropping a frame\n");
+		g_main_loop_quit(loop);
+	}
+}
+
+static void start_client(gchar **command, GPtrArray *addresses)
+{
+	GPtrArray *argv = g_ptr_array_new_with_free_func(g_free);
+	GError *error = NULL;
+	guint i;
+
+	for(; *command; command++)
+		g_ptr_array_add(argv, g_strdup(*command));
+	for(i = 0; i < addresses->len; i++)
+		g_ptr_array_add(argv, g_strdup_printf("--host=%s",
+				(gchar *)g_ptr_array_index(addresses, i)));
+	if(ramp)
+		g_ptr_array_add(argv, g_strdup_printf("--frame-log=%s",
+						      ramp_log));
+	g_ptr_array_add(argv, NULL);
+
+	if(!g_spawn_async(NULL, (gchar **)argv->pdata, NULL,
+			  G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+			  NULL, NULL, &client_pid, &error)) {
+		fprintf(stderr, "Failed to start %s: %s\n",
+			(gchar *)argv->pdata[0], error->message);
+		g_error_free(error);
+	} else
+		g_child_watch_add(client_pid, client_exited, NULL);
+	g_ptr_array_free(argv, TRUE);
+}
+
+static gboolean open_ramp_log(void)
+{
+	GError *error = NULL;
+	gint fd;
+
+	fd = g_file_open_tmp("connman-gtk-frames-XXXXXX.csv", &ramp_log,
+			     &error);
+	if(fd < 0) {
+		fprintf(stderr, "Failed to create the frame log: %s\n",
+			error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+	close(fd);
+	return TRUE;
+}
+
+static struct mock *mock_create(const gchar *address)
+{
+	struct mock *mock = mock_new(address);
+
+	mock_add_technology(mock, "ethernet", TRUE);
+	mock_add_technology(mock, "wifi", TRUE);
+	mock_add_services(mock, "ethernet", 1);
+	mock_add_services(mock, "wifi", (guint)services);
+	mock_add_vpn_connections(mock, (guint)connections);
+	mock_set_connect_timing(mock, (guint)connect_step, (guint)connect_fail);
+	return mock;
+}
+
+static void bus_free(gpointer data)
+{
+	GTestDBus *bus = data;
+
+	g_test_dbus_down(bus);
+	g_object_unref(bus);
+}
+
+static const GOptionEntry options[] = {
+	{ "hosts", 0, 0, G_OPTION_ARG_INT, &hosts,
+		"Number of daemons, each on a private bus, 1 by default",
+		"N" },
+	{ "services", 0, 0, G_OPTION_ARG_INT, &services,
+		"Number of wireless services, 100 by default", "N" },
+	{ "vpn", 0, 0, G_OPTION_ARG_INT, &connections,
+		"Number of VPN connections, 2 by default", "N" },
+	{ "rate", 0, 0, G_OPTION_ARG_INT, &rate,
+		"Send N PropertyChanged signals per second", "N" },
+	{ "ramp", 0, 0, G_OPTION_ARG_INT, &ramp,
+		"Raise the rate by N until the client drops frames", "N" },
+	{ "max", 0, 0, G_OPTION_ARG_NONE, &max_speed,
+		"Send PropertyChanged signals as fast as possible", NULL },
+	{ "updates", 0, 0, G_OPTION_ARG_INT, &updates,
+		"Stop after N signals", "N" },
+	{ "restart", 0, 0, G_OPTION_ARG_INT, &restart,
+		"Restart the daemon every S seconds", "S" },
+	{ "connect-step", 0, 0, G_OPTION_ARG_INT, &connect_step,
+		"Take MS between the states of a connect", "MS" },
+	{ "connect-fail", 0, 0, G_OPTION_ARG_INT, &connect_fail,
+		"Fail every Nth connect", "N" },
+	{ "address", 0, 0, G_OPTION_ARG_STRING, &bus_address,
+		"Use the bus at ADDRESS instead of a private one", "ADDRESS" },
+	{ NULL }
+};
+
+int main(int argc, char *argv[])
+{
+	GOptionContext *context;
+	GPtrArray *buses, *addresses;
+	GError *error = NULL;
+	gchar **command = NULL;
+	int i, status = 1;
+
+	context = g_option_context_new("[-- COMMAND]");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		return 1;
+	}
+	g_option_context_free(context);
+	for(i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--"))
+			continue;
+		command = argv + i + 1;
+		break;
+	}
+	if(!command && argc > 1)
+		command = argv + 1;
+	if(hosts < 1 || (hosts > 1 && bus_address) || services < 1 ||
+	   connections < 0 || rate < 0 || updates < 0 || restart < 0 ||
+	   connect_step < 0 || connect_fail < 0 || ramp < 0 ||
+	   (ramp && (!command || !*command))) {
+		fprintf(stderr, "Usage: %s [--hosts=N] [--services=N] "
+			"[--rate=N | --max | --ramp=N] [-- COMMAND]\n",
+			argv[0]);
+		return 1;
+	}
+	if(ramp && !open_ramp_log())
+		return 1;
+
+	buses = g_ptr_array_new_with_free_func(bus_free);
+	addresses = g_ptr_array_new_with_free_func(g_free);
+	mocks = g_ptr_array_new_with_free_func((GDestroyNotify)mock_free);
+	if(bus_address)
+		g_ptr_array_add(addresses, g_strdup(bus_address));
+	for(i = 0; !bus_address && i < hosts; i++) {
+		GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+
+		g_test_dbus_up(bus);
+		g_ptr_array_add(buses, bus);
+		g_ptr_array_add(addresses,
+				g_strdup(g_test_dbus_get_bus_address(bus)));
+	}
+	for(i = 0; i < (int)addresses->len; i++) {
+		const gchar *address = g_ptr_array_index(addresses, i);
+		struct mock *mock = mock_create(address);
+
+		printf("Bus address: %s\n", address);
+		g_ptr_array_add(mocks, mock);
+		if(!mock_start(mock))
+			goto out;
+	}
+	emit_updates();
+
+	if(command && *command)
+		start_client(command, addresses);
+
+	loop = g_main_loop_new(NULL, FALSE);
+	if(restart)
+		g_timeout_add_seconds((guint)restart, mock_restart, NULL);
+	if(ramp)
+		g_timeout_add_seconds(RAMP_PERIOD, ramp_step, NULL);
+	g_main_loop_run(loop);
+	g_main_loop_unref(loop);
+	status = 0;
+
+out:
+	if(ramp && client_pid)
+		kill(client_pid, SIGTERM);
+	if(ramp_file)
+		fclose(ramp_file);
+	if(ramp_log) {
+		g_unlink(ramp_log);
+		g_free(ramp_log);
+	}
+	g_ptr_array_free(mocks, TRUE);
+	g_ptr_array_free(addresses, TRUE);
+	g_ptr_array_free(buses, TRUE);
+	return status;
+}
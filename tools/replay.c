@@ -0,0 +1,417 @@
+/*
+ * ConnMan GTK GUI
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ * Author: Jaakko Hannikainen <jaakko.hannikainen@intel.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Replays a trace recorded with connman-gtk --record-trace. The recorded
+ * GetTechnologies, GetServices and GetConnections replies are served as
+ * net.connman and net.connman.vpn on a private bus, and once the client
+ * has fetched the services the recorded signals are emitted at the
+ * recorded pace, N times faster or as fast as possible.
+ *
+ *	connman-gtk-replay [--speed=N | --max] TRACE -- connman-gtk
+ *
+ * The command after -- is started with --host pointing at the bus.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "interfaces.h"
+#include "trace.h"
+
+/* Signals emitted per main loop iteration at full speed */
+#define REPLAY_BATCH 256
+
+static const gchar introspection[] =
+	"<node>"
+	" <interface name='" MANAGER_NAME "'>"
+	"  <method name='GetTechnologies'>"
+	"   <arg type='a(oa{sv})' direction='out'/>"
+	"  </method>"
+	"  <method name='GetServices'>"
+	"   <arg type='a(oa{sv})' direction='out'/>"
+	"  </method>"
+	"  <method name='RegisterAgent'><arg type='o'/></method>"
+	"  <method name='UnregisterAgent'><arg type='o'/></method>"
+	" </interface>"
+	" <interface name='" VPN_MANAGER_NAME "'>"
+	"  <method name='GetConnections'>"
+	"   <arg type='a(oa{sv})' direction='out'/>"
+	"  </method>"
+	"  <method name='RegisterAgent'><arg type='o'/></method>"
+	"  <method name='UnregisterAgent'><arg type='o'/></method>"
+	" </interface>"
+	"</node>";
+
+static GMainLoop *loop;
+static GDBusConnection *connman, *vpn;
+/* first reply of every method, keyed by "interface.method" */
+static GHashTable *replies;
+static GPtrArray *signals;
+static guint next_signal;
+static gboolean started;
+static gint64 replay_start;
+static guint64 trace_start;
+
+static gdouble speed = 1;
+static gboolean max_speed;
+static gchar *bus_address;
+
+static gboolean load_trace(const gchar *filename)
+{
+	struct trace_reader *reader;
+	GError *error = NULL;
+	GVariant *record;
+	guint64 services_time = 0;
+	guint i;
+
+	reader = trace_reader_new(filename, &error);
+	if(!reader) {
+		fprintf(stderr, "%s\n", error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+
+	replies = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					(GDestroyNotify)g_variant_unref);
+	signals = g_ptr_array_new_with_free_func(
+				(GDestroyNotify)g_variant_unref);
+	while((record = trace_reader_next(reader, &error))) {
+		const gchar *interface, *member;
+		guchar kind;
+		guint64 time;
+		GVariant *body;
+
+		g_variant_get(record, "(yt&s&o&s&sv)", &kind, &time, NULL,
+			      NULL, &interface, &member, &body);
+		if(kind == TRACE_REPLY) {
+			gchar *key = g_strdup_printf("%s.%s", interface,
+						     member);
+
+			if(!services_time && !strcmp(member, "GetServices"))
+				services_time = time;
+			if(g_hash_table_contains(replies, key))
+				g_free(key);
+			else
+				g_hash_table_insert(replies, key,
+						    g_variant_ref(body));
+			g_variant_unref(record);
+		} else {
+			g_ptr_array_add(signals, record);
+		}
+		g_variant_unref(body);
+	}
+	trace_reader_free(reader);
+	if(error) {
+		fprintf(stderr, "%s\n", error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+
+	/* what came before the GetServices reply is part of that state */
+	for(i = 0; i < signals->len; i++) {
+		guint64 time;
+
+		g_variant_get_child(g_ptr_array_index(signals, i), 1, "t",
+				    &time);
+		if(time >= services_time)
+			break;
+	}
+	g_ptr_array_remove_range(signals, 0, i);
+	printf("%u signals, %u replies\n", signals->len,
+	       g_hash_table_size(replies));
+	return TRUE;
+}
+
+static void emit(GVariant *record)
+{
+	const gchar *name, *path, *interface, *member;
+	GDBusConnection *connection;
+	GError *error = NULL;
+	GVariant *body;
+
+	g_variant_get(record, "(yt&s&o&s&sv)", NULL, NULL, &name, &path,
+		      &interface, &member, &body);
+	connection = strcmp(name, CONNMAN_VPN_PATH) ? connman : vpn;
+	if(!g_dbus_connection_emit_signal(connection, NULL, path, interface,
+					  member, body, &error)) {
+		fprintf(stderr, "Failed to emit %s: %s\n", member,
+			error->message);
+		g_error_free(error);
+	}
+	g_variant_unref(body);
+}
+
+static guint64 signal_offset(guint index)
+{
+	guint64 time;
+
+	g_variant_get_child(g_ptr_array_index(signals, index), 1, "t", &time);
+	return time - trace_start;
+}
+
+static gboolean replay_step(gpointer user_data)
+{
+	gint64 now = g_get_monotonic_time() - replay_start;
+	gint64 due;
+	guint n;
+
+	for(n = 0; next_signal < signals->len && n < REPLAY_BATCH; n++) {
+		due = (gint64)((gdouble)signal_offset(next_signal) / speed);
+		if(!max_speed && due > now)
+			break;
+		emit(g_ptr_array_index(signals, next_signal++));
+	}
+
+	if(next_signal == signals->len) {
+		g_dbus_connection_flush_sync(connman, NULL, NULL);
+		g_dbus_connection_flush_sync(vpn, NULL, NULL);
+		printf("Replayed %u signals in %.1f ms, %.1f ms recorded\n",
+		       signals->len,
+		       (gdouble)(g_get_monotonic_time() - replay_start) / 1000,
+		       signals->len ? (gdouble)signal_offset(
+				      signals->len - 1) / 1000 : 0.0);
+		g_main_loop_quit(loop);
+	} else if(max_speed || n == REPLAY_BATCH) {
+		g_idle_add(replay_step, NULL);
+	} else {
+		due = (gint64)((gdouble)signal_offset(next_signal) / speed);
+		g_timeout_add((guint)((due - now) / 1000), replay_step, NULL);
+	}
+	return G_SOURCE_REMOVE;
+}
+
+static void start_replay(void)
+{
+	if(started)
+		return;
+	started = TRUE;
+	replay_start = g_get_monotonic_time();
+	if(signals->len)
+		g_variant_get_child(g_ptr_array_index(signals, 0), 1, "t",
+				    &trace_start);
+	g_idle_add(replay_step, NULL);
+}
+
+static void method_call(GDBusConnection *connection, const gchar *sender,
+			const gchar *path, const gchar *interface,
+			const gchar *method, GVariant *parameters,
+			GDBusMethodInvocation *invocation, gpointer user_data)
+{
+	GVariant *reply;
+	gchar *key;
+
+	if(!strcmp(method, "RegisterAgent") ||
+	   !strcmp(method, "UnregisterAgent")) {
+		g_dbus_method_invocation_return_value(invocation, NULL);
+		return;
+	}
+
+	key = g_strdup_printf("%s.%s", interface, method);
+	reply = g_hash_table_lookup(replies, key);
+	g_free(key);
+	if(reply)
+		g_dbus_method_invocation_return_value(invocation, reply);
+	else
+		g_dbus_method_invocation_return_value(invocation,
+			g_variant_new("(@a(oa{sv}))",
+				      g_variant_new_array(
+					G_VARIANT_TYPE("(oa{sv})"), NULL, 0)));
+
+	/* the client has its initial state, start the recorded changes */
+	if(!strcmp(method, "GetServices"))
+		start_replay();
+}
+
+static const GDBusInterfaceVTable vtable = {
+	method_call,
+	NULL,
+	NULL
+};
+
+static GDBusConnection *serve(const gchar *name, GDBusNodeInfo *node,
+			      const gchar *interface)
+{
+	GDBusConnection *connection;
+	GError *error = NULL;
+	GVariant *ret;
+
+	connection = g_dbus_connection_new_for_address_sync(bus_address,
+			G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+			G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+			NULL, NULL, &error);
+	if(!connection) {
+		fprintf(stderr, "Failed to connect to %s: %s\n", bus_address,
+			error->message);
+		g_error_free(error);
+		return NULL;
+	}
+
+	g_dbus_connection_register_object(connection, "/",
+			g_dbus_node_info_lookup_interface(node, interface),
+			&vtable, NULL, NULL, NULL);
+	ret = g_dbus_connection_call_sync(connection, "org.freedesktop.DBus",
+					  "/org/freedesktop/DBus",
+					  "org.freedesktop.DBus",
+					  "RequestName",
+					  g_variant_new("(su)", name, 0),
+					  NULL, G_DBUS_CALL_FLAGS_NONE, -1,
+					  NULL, &error);
+	if(!ret) {
+		fprintf(stderr, "Failed to own %s: %s\n", name,
+			error->message);
+		g_error_free(error);
+		g_object_unref(connection);
+		return NULL;
+	}
+	g_variant_unref(ret);
+	return connection;
+}
+
+/* A bus of our own, so the replay cannot reach a real daemon */
+static GPid start_bus(void)
+{
+	gchar *argv[] = { "dbus-daemon", "--session", "--nofork",
+			  "--print-address=1", NULL };
+	GError *error = NULL;
+	GIOChannel *channel;
+	gint out;
+	GPid pid;
+
+	if(!g_spawn_async_with_pipes(NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+				     NULL, NULL, &pid, NULL, &out, NULL,
+				     &error)) {
+		fprintf(stderr, "Failed to start dbus-daemon: %s\n",
+			error->message);
+		g_error_free(error);
+		return 0;
+	}
+
+	channel = g_io_channel_unix_new(out);
+	if(g_io_channel_read_line(channel, &bus_address, NULL, NULL, NULL) !=
+	   G_IO_STATUS_NORMAL) {
+		fprintf(stderr, "dbus-daemon did not print its address\n");
+		kill(pid, SIGTERM);
+		pid = 0;
+	} else {
+		g_strstrip(bus_address);
+	}
+	g_io_channel_unref(channel);
+	return pid;
+}
+
+static void start_client(gchar **command)
+{
+	GPtrArray *argv = g_ptr_array_new_with_free_func(g_free);
+	GError *error = NULL;
+
+	for(; *command; command++)
+		g_ptr_array_add(argv, g_strdup(*command));
+	g_ptr_array_add(argv, g_strdup_printf("--host=%s", bus_address));
+	g_ptr_array_add(argv, NULL);
+
+	if(!g_spawn_async(NULL, (gchar **)argv->pdata, NULL,
+			  G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, &error)) {
+		fprintf(stderr, "Failed to start %s: %s\n",
+			(gchar *)argv->pdata[0], error->message);
+		g_error_free(error);
+	}
+	g_ptr_array_free(argv, TRUE);
+}
+
+static const GOptionEntry options[] = {
+	{ "speed", 0, 0, G_OPTION_ARG_DOUBLE, &speed,
+		"Replay N times faster than recorded", "N" },
+	{ "max", 0, 0, G_OPTION_ARG_NONE, &max_speed,
+		"Replay as fast as possible", NULL },
+	{ "address", 0, 0, G_OPTION_ARG_STRING, &bus_address,
+		"Use the bus at ADDRESS instead of a private one", "ADDRESS" },
+	{ NULL }
+};
+
+int main(int argc, char *argv[])
+{
+	GOptionContext *context;
+	GDBusNodeInfo *node;
+	GError *error = NULL;
+	gchar **command = NULL;
+	GPid bus = 0;
+	int i, status = 1;
+
+	context = g_option_context_new("TRACE [-- COMMAND]");
+	g_option_context_add_main_entries(context, options, NULL);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		return 1;
+	}
+	g_option_context_free(context);
+	if(argc < 2 || speed <= 0) {
+		fprintf(stderr, "Usage: %s [--speed=N | --max] TRACE "
+			"[-- COMMAND]\n", argv[0]);
+		return 1;
+	}
+	for(i = 2; i < argc; i++) {
+		if(strcmp(argv[i], "--"))
+			continue;
+		command = argv + i + 1;
+		break;
+	}
+	if(!command && argc > 2)
+		command = argv + 2;
+
+	if(!load_trace(argv[1]))
+		return 1;
+
+	if(!bus_address) {
+		bus = start_bus();
+		if(!bus)
+			return 1;
+	}
+	printf("Bus address: %s\n", bus_address);
+
+	node = g_dbus_node_info_new_for_xml(introspection, NULL);
+	connman = serve(CONNMAN_PATH, node, MANAGER_NAME);
+	vpn = serve(CONNMAN_VPN_PATH, node, VPN_MANAGER_NAME);
+	if(!connman || !vpn)
+		goto out;
+
+	if(command && *command)
+		start_client(command);
+
+	loop = g_main_loop_new(NULL, FALSE);
+	g_main_loop_run(loop);
+	g_main_loop_unref(loop);
+	status = 0;
+
+out:
+	g_clear_object(&connman);
+	g_clear_object(&vpn);
+	g_dbus_node_info_unref(node);
+	if(bus)
+		kill(bus, SIGTERM);
+	return status;
+}